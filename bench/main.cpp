@@ -0,0 +1,363 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "delaunay.h"
+#include "ear_clip.h"
+#include "harness.h"
+#include "mesh_order.h"
+#include "verify.h"
+
+namespace ec = ear_clip;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double milliseconds(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+template <class F>
+double measure(F &&f) {
+  auto start = Clock::now();
+  f();
+  return milliseconds(Clock::now() - start);
+}
+
+// Generated input families
+
+// A wavy band: long runs of neighbouring triangles
+ec::Ring wave(size_t vertices) {
+  ec::Ring result;
+  auto half = vertices / 2;
+  for (size_t i = 0; i < half; ++i)
+    result.push_back({double(i), std::sin(0.1 * double(i))});
+  for (size_t i = half; i-- > 0;)
+    result.push_back({double(i), 3 + std::sin(0.1 * double(i))});
+  return result;
+}
+
+// A star with the spikes of alternating length: a fan around the center
+ec::Ring star(size_t vertices) {
+  ec::Ring result;
+  for (size_t i = 0; i < vertices; ++i) {
+    auto angle = 2 * M_PI * double(i) / double(vertices);
+    auto radius = i % 2 == 0 ? 1.0 : 0.7;
+    result.push_back({radius * std::cos(angle), radius * std::sin(angle)});
+  }
+  return result;
+}
+
+// A comb: teeth along a spine
+ec::Ring comb(size_t vertices) {
+  ec::Ring result;
+  auto teeth = std::max<size_t>(vertices / 4, 1);
+  for (size_t i = 0; i < teeth; ++i) {
+    result.push_back({2.0 * double(i), 0});
+    result.push_back({2.0 * double(i), 10});
+    result.push_back({2.0 * double(i) + 1, 10});
+    result.push_back({2.0 * double(i) + 1, 1});
+  }
+  result.push_back({2.0 * double(teeth), -1});
+  result.push_back({0, -1});
+  return result;
+}
+
+// An over-sampled circle with a small noise: most vertices are redundant
+ec::Ring noisyCircle(size_t vertices) {
+  ec::Ring result;
+  for (size_t i = 0; i < vertices; ++i) {
+    auto angle = 2 * M_PI * double(i) / double(vertices);
+    auto radius = 1 + 0.001 * std::sin(977.0 * double(i));
+    result.push_back({radius * std::cos(angle), radius * std::sin(angle)});
+  }
+  return result;
+}
+
+// A regular polygon: every vertex is an ear
+ec::Ring convex(size_t vertices) {
+  ec::Ring result;
+  for (size_t i = 0; i < vertices; ++i) {
+    auto angle = 2 * M_PI * double(i) / double(vertices);
+    result.push_back({std::cos(angle), std::sin(angle)});
+  }
+  return result;
+}
+
+// A band wound 4 times: the reflex vertices of the inner side are near most ears
+ec::Ring spiral(size_t vertices) {
+  ec::Ring result;
+  auto half = std::max<size_t>(vertices / 2, 2);
+  auto point = [half](size_t i, double offset) {
+    auto angle = 8 * M_PI * double(i) / double(half - 1);
+    auto radius = 1 + angle + offset;
+    return ec::Point{radius * std::cos(angle), radius * std::sin(angle)};
+  };
+  for (size_t i = 0; i < half; ++i)
+    result.push_back(point(i, 0));
+  for (size_t i = half; i-- > 0;)
+    result.push_back(point(i, 1));
+  return result;
+}
+
+// Back and forth lines, across then along: sqrt(crossings) lines both ways,
+// so the split points outnumber the 4 * sqrt(crossings) ring vertices
+ec::Ring grid(size_t crossings) {
+  ec::Ring result;
+  auto lines = std::max<size_t>(std::lround(std::sqrt(double(crossings))), 1);
+  auto size = double(lines + 1);
+  for (size_t i = 0; i < lines; ++i) {
+    auto y = double(i) + 0.5;
+    result.push_back({i % 2 == 0 ? 0 : size, y});
+    result.push_back({i % 2 == 0 ? size : 0, y});
+  }
+  for (size_t i = lines; i-- > 0;) {
+    auto x = double(i) + 0.5;
+    result.push_back({x, i % 2 == 0 ? size : 0});
+    result.push_back({x, i % 2 == 0 ? 0 : size});
+  }
+  return result;
+}
+
+struct Family {
+  std::string name;
+  std::function<ec::Ring(size_t)> generate;
+};
+
+// Rendering cost of the index output: ACMR of the triangle orders and the index buffer sizes
+void benchMeshOrder(const Family &family, size_t vertices, size_t cacheSize) {
+  auto ring = family.generate(vertices);
+  ec::Mesh mesh;
+  auto triangulateTime = measure([&]() { mesh = ec::triangulateMesh(ring); });
+
+  auto hilbert = mesh;
+  auto hilbertTime = measure([&]() { ec::reorderAlongHilbertCurve(hilbert); });
+  auto cache = mesh;
+  auto cacheTime = measure([&]() { ec::reorderForVertexCache(cache, cacheSize); });
+  auto both = hilbert;
+  ec::reorderForVertexCache(both, cacheSize);
+
+  std::pmr::vector<uint32_t> strips, fans;
+  auto stripsTime = measure([&]() { strips = ec::triangleStrips(cache); });
+  auto fansTime = measure([&]() { fans = ec::triangleFans(mesh); });
+
+  std::cout << std::fixed << std::setprecision(3)
+            << family.name << ", " << ring.size() << " vertices, " << mesh.triangles.size() << " triangles\n"
+            << "  triangulateMesh: " << triangulateTime << " ms\n"
+            << "  ACMR(cache " << cacheSize << "): clip order " << ec::acmr(mesh.triangles, cacheSize)
+            << ", hilbert " << ec::acmr(hilbert.triangles, cacheSize) << " (" << hilbertTime << " ms)"
+            << ", vertex cache " << ec::acmr(cache.triangles, cacheSize) << " (" << cacheTime << " ms)"
+            << ", hilbert + vertex cache " << ec::acmr(both.triangles, cacheSize) << '\n'
+            << "  indices: triangles " << 3 * mesh.triangles.size()
+            << ", strips " << strips.size() << " ACMR " << ec::acmr(strips, ec::Primitive::TRIANGLE_STRIP, cacheSize)
+            << " (" << stripsTime << " ms)"
+            << ", fans " << fans.size() << " ACMR " << ec::acmr(fans, ec::Primitive::TRIANGLE_FAN, cacheSize)
+            << " (" << fansTime << " ms)\n";
+}
+
+// The mean of the smallest triangle angles, degrees
+double meanMinAngle(const ec::Mesh &mesh) {
+  double sum = 0;
+  for (const auto &t : mesh.triangles) {
+    double smallest = 180;
+    for (size_t i = 0; i < 3; ++i) {
+      auto a = mesh.vertices[t[i]], b = mesh.vertices[t[(i + 1) % 3]], c = mesh.vertices[t[(i + 2) % 3]];
+      auto angle = ec::details::angleRad(b, a, c) * 180 / M_PI;
+      smallest = std::min({smallest, angle, 360 - angle});
+    }
+    sum += smallest;
+  }
+  return mesh.triangles.empty() ? 0 : sum / double(mesh.triangles.size());
+}
+
+// Constrained Delaunay flips cost and the sliver improvement
+void benchDelaunay(const Family &family, size_t vertices) {
+  auto mesh = ec::triangulateMesh(family.generate(vertices));
+  auto before = meanMinAngle(mesh);
+  size_t flips = 0;
+  auto time = measure([&]() { flips = ec::makeDelaunay(mesh); });
+  std::cout << std::fixed << std::setprecision(3)
+            << "  makeDelaunay: " << flips << " flips, " << time << " ms, mean min angle " << before << " -> "
+            << meanMinAngle(mesh) << " degrees\n";
+}
+
+// The simplification pre-pass: how many vertices it removes and what it saves
+void benchSimplify(const Family &family, size_t vertices, double tolerance) {
+  auto ring = family.generate(vertices);
+  ec::TriangulationStats stats;
+  ec::Options options;
+  options.stats = &stats;
+  options.simplifyTolerance = tolerance;
+  auto plainTime = measure([&]() { ec::triangulate(ring); });
+  auto simplifiedTime = measure([&]() { ec::triangulate(ring, options); });
+  std::cout << std::fixed << std::setprecision(3)
+            << "  simplify(" << tolerance << "): " << ring.size() << " -> " << ring.size() - stats.simplifiedPoints
+            << " vertices in " << milliseconds(stats.simplifyTime) << " ms, triangulate " << plainTime << " -> "
+            << simplifiedTime << " ms\n";
+}
+
+// The verification cost against the triangulation one
+void benchVerify(const Family &family, size_t vertices) {
+  auto ring = family.generate(vertices);
+  ec::Triangles triangles;
+  auto triangulateTime = measure([&]() { triangles = ec::triangulate(ring); });
+  ec::VerificationReport report;
+  auto verifyTime = measure([&]() { report = ec::verifyTriangulation(ring, triangles); });
+  std::cout << std::fixed << std::setprecision(3)
+            << "  verifyTriangulation: " << verifyTime << " ms(triangulate " << triangulateTime << " ms), "
+            << (report.valid() ? "valid" : "invalid") << '\n';
+}
+
+// Replays the saved fuzz inputs: corpus/triangulate through triangulate(),
+// corpus/normalize_ring through normalizeRing()(normalizeFaces() with a fill rule)
+void benchCorpus(const std::filesystem::path &corpus) {
+  for (const auto &target : {"triangulate", "normalize_ring"}) {
+    auto directory = corpus / target;
+    if (!std::filesystem::is_directory(directory))
+      continue;
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory))
+      paths.push_back(entry.path());
+    std::sort(paths.begin(), paths.end());
+
+    std::cout << "Corpus " << target << ", " << paths.size() << " inputs\n";
+    for (const auto &path : paths) {
+      std::ifstream file(path, std::ios::binary);
+      std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      auto input = ec::fuzz::decode(data.data(), data.size());
+      ec::TriangulationStats stats;
+      auto options = input.options;
+      options.stats = &stats;
+      auto time = measure([&]() {
+        if (std::strcmp(target, "triangulate") == 0)
+          ec::triangulate(input.ring, options);
+        else if (options.fillRule)
+          ec::details::normalizeFaces(input.ring, *options.fillRule, options);
+        else
+          ec::details::normalizeRing(input.ring, options);
+      });
+      // Per vertex of the split ring, as the fuzz targets limit it
+      auto vertices = std::max<size_t>(input.ring.size() + stats.splitPoints, 1);
+      std::cout << std::fixed << std::setprecision(3)
+                << "  " << path.filename().string() << ": " << input.ring.size() << " vertices, " << stats.splitPoints
+                << " split points, " << time << " ms, " << 1e6 * time / double(vertices) << " ns per vertex\n";
+    }
+  }
+}
+
+// The least squares slope of log(time) over log(size): the exponent of the time growth
+double logLogSlope(const std::vector<std::pair<double, double>> &samples) {
+  double meanX = 0, meanY = 0;
+  for (const auto &[size, time] : samples) {
+    meanX += std::log(size) / double(samples.size());
+    meanY += std::log(time) / double(samples.size());
+  }
+  double covariance = 0, variance = 0;
+  for (const auto &[size, time] : samples) {
+    covariance += (std::log(size) - meanX) * (std::log(time) - meanY);
+    variance += (std::log(size) - meanX) * (std::log(size) - meanX);
+  }
+  return covariance / variance;
+}
+
+// Fails when the time of a family grows faster than the configured exponent.
+// Each call is timed at a fixed range of doubling sizes, the fastest of the
+// repeated runs is taken as the others are slowed down by the machine, not by
+// the code. The small sizes are repeated until they take a minimum time, so
+// their timer noise doesn't tilt the slope. The size is the split ring one:
+// the ring vertices and the split points, so the families of many crossings
+// are checked against their output. The ctest gate runs it in the optimized
+// builds only.
+bool checkComplexity() {
+  const size_t firstSize = 500, sizes = 5, minRepeats = 5;
+  const double minTime = 20; // ms per size
+  struct Check {
+    Family family;
+    double triangulate, normalize; // the largest exponents allowed
+  };
+  // An ear candidate is tested against all the other vertices, so the clipping
+  // is quadratic; the intersection search and the traversal are about n log n
+  const std::vector<Check> checks = {{{"Convex", convex}, 2.3, 1.5},
+                                     {{"Comb", comb}, 2.3, 1.5},
+                                     {{"Spiral", spiral}, 2.3, 1.5},
+                                     {{"Grid", grid}, 1.5, 1.5}};
+  struct Call {
+    std::string name;
+    double Check::*limit;
+    std::function<void(const ec::Ring &, const ec::Options &)> run;
+  };
+  const std::vector<Call> calls = {
+      {"triangulate", &Check::triangulate, [](const ec::Ring &r, const ec::Options &o) { ec::triangulate(r, o); }},
+      {"normalizeRing", &Check::normalize,
+       [](const ec::Ring &r, const ec::Options &o) { ec::details::normalizeRing(r, o); }}};
+
+  bool passed = true;
+  for (const auto &check : checks) {
+    for (const auto &call : calls) {
+      std::vector<std::pair<double, double>> samples;
+      for (size_t size = firstSize; samples.size() < sizes; size *= 2) {
+        auto ring = check.family.generate(size);
+        // Single threaded, the worker count would change the slope otherwise
+        ec::Options options;
+        options.threads = 1;
+        ec::TriangulationStats stats;
+        options.stats = &stats;
+        call.run(ring, options);
+        options.stats = nullptr;
+        auto time = std::numeric_limits<double>::max();
+        double total = 0;
+        for (size_t i = 0; i < minRepeats || total < minTime; ++i) {
+          auto run = measure([&]() { call.run(ring, options); });
+          time = std::min(time, run);
+          total += run;
+        }
+        samples.emplace_back(double(ring.size() + stats.splitPoints), std::max(time, 1e-3));
+      }
+      auto slope = logLogSlope(samples);
+      auto limit = check.*call.limit;
+      passed &= slope <= limit;
+      std::cout << std::fixed << std::setprecision(2)
+                << check.family.name << ", " << call.name << ": " << samples.front().first << " -> "
+                << samples.back().first << " vertices, " << samples.front().second << " -> "
+                << samples.back().second << " ms, exponent " << slope << " (limit " << limit << ") "
+                << (slope <= limit ? "OK" : "Failed") << '\n';
+    }
+  }
+  return passed;
+}
+
+} // namespace
+
+// Usage: bench [vertices [fuzz corpus directory]]
+//        bench --complexity
+int main(int argc, char *argv[]) {
+  ec::enableTrace(false);
+  if (argc > 1 && std::strcmp(argv[1], "--complexity") == 0)
+    return checkComplexity() ? EXIT_SUCCESS : EXIT_FAILURE;
+  size_t vertices = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+  std::filesystem::path corpus = argc > 2 ? argv[2] : EAR_CLIP_FUZZ_CORPUS;
+  const size_t cacheSize = 16;
+
+  const std::vector<Family> families = {{"Wave", wave}, {"Star", star}, {"Comb", comb}, {"Noisy circle", noisyCircle}};
+  for (const auto &family : families) {
+    benchMeshOrder(family, vertices, cacheSize);
+    benchDelaunay(family, vertices);
+    benchSimplify(family, vertices, 0.01);
+    benchVerify(family, vertices);
+  }
+  benchCorpus(corpus);
+
+  return EXIT_SUCCESS;
+}
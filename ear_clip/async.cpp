@@ -0,0 +1,108 @@
+#include "async.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+
+namespace ear_clip {
+
+struct AsyncTriangulation::State {
+  std::atomic<bool> cancel{false};
+  std::mutex mutex;
+  std::condition_variable completed;
+  // guarded by the mutex
+  std::optional<AsyncResult> result;
+  std::function<void()> continuation;
+
+  void complete(AsyncResult &&value) {
+    std::function<void()> next;
+    {
+      std::lock_guard lock(mutex);
+      result = std::move(value);
+      next = std::move(continuation);
+    }
+    completed.notify_all();
+    if (next)
+      next();
+  }
+};
+
+// The posted work, shared by the copies of the task. If none of them runs, the
+// last one destroyed completes the call.
+struct AsyncTriangulation::Job {
+  std::shared_ptr<State> state;
+  Ring ring;
+  Options options;
+  bool done = false;
+
+  Job(std::shared_ptr<State> state, Ring ring, const Options &options)
+      : state(std::move(state)), ring(std::move(ring)), options(options) {}
+  Job(const Job &) = delete;
+  Job &operator=(const Job &) = delete;
+
+  void cancelled() {
+    auto memory = options.memory ? options.memory : std::pmr::get_default_resource();
+    state->complete({Status::CANCELLED, Triangles(memory), {}});
+  }
+
+  ~Job() {
+    if (!done)
+      cancelled();
+  }
+
+  void run() {
+    done = true;
+    if (state->cancel) {
+      cancelled();
+      return;
+    }
+    TriangulationStats stats;
+    options.stats = &stats;
+    auto result = tryTriangulate(std::move(ring), options);
+    // moved, not assigned, to keep the options.memory allocator
+    state->complete({result.status, std::move(result.value), stats});
+  }
+};
+
+bool AsyncTriangulation::ready() const {
+  std::lock_guard lock(state->mutex);
+  return state->result.has_value();
+}
+
+void AsyncTriangulation::cancel() const noexcept {
+  state->cancel = true;
+}
+
+AsyncResult AsyncTriangulation::get() {
+  std::unique_lock lock(state->mutex);
+  state->completed.wait(lock, [this] { return state->result.has_value(); });
+  return std::move(*state->result);
+}
+
+void AsyncTriangulation::then(std::function<void(AsyncResult)> f) {
+  auto s = state;
+  if (suspend([s, f = std::move(f)] { f(std::move(*s->result)); }))
+    return;
+  f(std::move(*state->result));
+}
+
+bool AsyncTriangulation::suspend(std::function<void()> resume) {
+  std::lock_guard lock(state->mutex);
+  if (state->result)
+    return false;
+  state->continuation = std::move(resume);
+  return true;
+}
+
+AsyncTriangulation triangulateAsync(Ring ring, Executor &executor, const Options &options) {
+  auto state = std::make_shared<AsyncTriangulation::State>();
+  auto job = std::make_shared<AsyncTriangulation::Job>(state, std::move(ring), options);
+  job->options.threads = std::max<size_t>(options.threads, 1);
+  job->options.cancel = &state->cancel;
+  executor.post([job] { job->run(); });
+  return AsyncTriangulation(std::move(state));
+}
+
+} // namespace ear_clip
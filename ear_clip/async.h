@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ear_clip.h"
+
+#include <functional>
+#include <memory>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define EAR_CLIP_COROUTINES 1
+#endif
+
+namespace ear_clip {
+
+// Runs the tasks of the asynchronous calls, e.g. on an event loop or a pool
+class Executor {
+ public:
+  virtual ~Executor() = default;
+  // Runs the task once, later or at once, on any thread. A task destroyed
+  // without running completes its call as CANCELLED.
+  virtual void post(std::function<void()> task) = 0;
+};
+
+struct AsyncResult {
+  Status status = Status::OK;
+  Triangles triangles; // see Result
+  TriangulationStats stats;
+};
+
+// The future of a triangulateAsync() call. The result is taken once: by
+// get(), then() or co_await(C++20).
+class AsyncTriangulation {
+ public:
+  AsyncTriangulation() = default;
+
+  [[nodiscard]] bool valid() const { return state != nullptr; }
+  [[nodiscard]] bool ready() const;
+  // Raises the flag the call polls, it completes as CANCELLED soon unless
+  // it's done already
+  void cancel() const noexcept;
+
+  // Blocks until the completion, so not on the executor thread the call waits for
+  AsyncResult get();
+  // Calls f with the result at once if it's ready, otherwise on the thread
+  // which completes the call
+  void then(std::function<void(AsyncResult)> f);
+
+#ifdef EAR_CLIP_COROUTINES
+  [[nodiscard]] bool await_ready() const { return ready(); }
+  bool await_suspend(std::coroutine_handle<> handle) {
+    return suspend([handle] { handle.resume(); });
+  }
+  AsyncResult await_resume() { return get(); }
+#endif
+
+ private:
+  struct State;
+  struct Job;
+
+  explicit AsyncTriangulation(std::shared_ptr<State> state) : state(std::move(state)) {}
+  // Sets the resume to be called on the completion, false if it's completed already
+  bool suspend(std::function<void()> resume);
+
+  friend AsyncTriangulation triangulateAsync(Ring ring, Executor &executor, const Options &options);
+
+  std::shared_ptr<State> state;
+};
+
+// tryTriangulate() in one task posted to the executor. The library starts no
+// threads for it unless options.threads > 1 asks for the workers explicitly
+// (0 is taken as 1). options.stats and options.cancel are replaced by the
+// result stats and the flag raised by AsyncTriangulation::cancel().
+AsyncTriangulation triangulateAsync(Ring ring, Executor &executor, const Options &options = {});
+
+} // namespace ear_clip
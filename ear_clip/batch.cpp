@@ -0,0 +1,184 @@
+#include "batch.h"
+#include "memory_resources.h"
+#include "point_welder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory_resource>
+#include <thread>
+
+namespace ear_clip {
+
+namespace {
+
+// Smaller batches aren't worth starting threads for(if their count isn't set explicitly)
+constexpr size_t PARALLEL_MIN_VERTICES = 4096;
+// A triangle vertex out of the pool(a self intersection point), it's welded after the workers
+constexpr uint32_t NOT_POOLED = UINT32_MAX;
+
+// A ring being triangulated
+struct RingBuilder {
+  explicit RingBuilder(std::pmr::memory_resource *memory) : triangles(memory), indices(memory) {}
+
+  Status status = Status::OK;
+  Triangles triangles; // kept only if some of the points aren't pooled
+  std::pmr::vector<Mesh::Indices> indices;
+};
+
+} // namespace
+
+Result<BatchMesh> tryTriangulateBatch(const std::pmr::vector<Ring> &rings, const Options &options) noexcept {
+  auto memory = options.memory ? options.memory : std::pmr::get_default_resource();
+  details::CountingResource countingMemory(memory);
+  auto tracked = options.stats ? &countingMemory : memory;
+  Result<BatchMesh> result{Status::OK,
+                           BatchMesh{std::pmr::vector<Point>(memory), std::pmr::vector<Mesh::Indices>(memory),
+                                     std::pmr::vector<size_t>(memory), std::pmr::vector<Status>(memory)}};
+  if (!(options.snapTolerance >= 0)) {
+    result.status = Status::INVALID_OPTIONS;
+    return result;
+  }
+
+  // A shared boundary is welded once, not by each of its rings
+  size_t vertices = 0;
+  for (const auto &ring : rings)
+    vertices += ring.size();
+  details::PointWelder pool(options.snapTolerance, tracked);
+  pool.reserve(vertices);
+  for (const auto &ring : rings) {
+    for (const auto &p : ring)
+      pool.weld(p);
+  }
+
+  auto threads = options.threads;
+  if (threads == 0)
+    threads = vertices < PARALLEL_MIN_VERTICES ? 1 : std::thread::hardware_concurrency();
+  threads = std::clamp<size_t>(threads, 1, std::max<size_t>(rings.size(), 1));
+  // The rings are triangulated in parallel, so their memory is shared between the threads
+  details::LockingResource sharedMemory(tracked);
+  auto scratch = threads > 1 ? &sharedMemory : tracked;
+
+  std::pmr::vector<RingBuilder> builders(tracked);
+  builders.reserve(rings.size());
+  for (size_t r = 0; r < rings.size(); ++r)
+    builders.emplace_back(scratch);
+  std::pmr::vector<TriangulationStats> threadStats(threads, tracked);
+  std::atomic<size_t> nextRing = 0;
+  std::atomic<bool> cancelled = false;
+
+  // The pool isn't changed until the workers are done, so they look it up at once
+  auto work = [&](size_t thread) {
+    auto ringOptions = options;
+    ringOptions.threads = 1;
+    ringOptions.memory = scratch;
+    ringOptions.stats = options.stats ? &threadStats[thread] : nullptr;
+    for (auto r = nextRing++; r < rings.size(); r = nextRing++) {
+      if (options.cancel && *options.cancel) {
+        cancelled = true;
+        return;
+      }
+      auto &builder = builders[r];
+      // The pool points, so the neighbours have the same coordinates of their common vertices
+      Ring ring(scratch);
+      for (const auto &p : rings[r])
+        ring.push_back(pool.points()[pool.find(p)]);
+      auto triangulation = tryTriangulate(std::move(ring), ringOptions);
+      builder.status = triangulation.status;
+
+      bool pooled = true;
+      builder.indices.reserve(triangulation.value.size());
+      for (const auto &t : triangulation.value) {
+        auto &indices = builder.indices.emplace_back();
+        for (size_t i = 0; i < 3; ++i) {
+          auto id = pool.find(t[i]);
+          pooled &= id != details::PointWelder::NO_ID;
+          indices[i] = id == details::PointWelder::NO_ID ? NOT_POOLED : static_cast<uint32_t>(id);
+        }
+      }
+      if (!pooled)
+        builder.triangles = std::move(triangulation.value); // the same allocator, so it isn't copied
+    }
+  };
+
+  {
+    std::pmr::vector<std::thread> workers(tracked);
+    workers.reserve(threads - 1);
+    for (size_t thread = 1; thread < threads; ++thread)
+      workers.emplace_back(work, thread);
+    work(0);
+    for (auto &worker : workers)
+      worker.join();
+  }
+  // The rings allocate from the counted memory too, so their own memory
+  // counters are dropped, they would count it twice
+  auto report = [&]() {
+    if (!options.stats)
+      return;
+    for (auto &s : threadStats) {
+      s.allocations = s.allocatedBytes = s.peakBytes = 0;
+      details::merge(*options.stats, s);
+    }
+    const auto &mesh = result.value;
+    size_t bytes = 0, allocations = 0;
+    auto returned = [&](const auto &v) {
+      bytes += v.capacity() * sizeof(v[0]);
+      allocations += v.capacity() != 0;
+    };
+    returned(mesh.vertices);
+    returned(mesh.triangles);
+    returned(mesh.ringOffsets);
+    returned(mesh.ringStatuses);
+    if (bytes != 0)
+      countingMemory.account(bytes, allocations);
+    countingMemory.report(*options.stats);
+  };
+  if (cancelled) {
+    result.status = Status::CANCELLED;
+    report();
+    return result;
+  }
+
+  // The split points are welded in the ring order, so the vertices don't depend on the threads
+  auto &mesh = result.value;
+  size_t triangles = 0;
+  for (const auto &builder : builders)
+    triangles += builder.indices.size();
+  mesh.triangles.reserve(triangles);
+  mesh.ringOffsets.reserve(rings.size() + 1);
+  mesh.ringStatuses.reserve(rings.size());
+  mesh.ringOffsets.push_back(0);
+  for (const auto &builder : builders) {
+    for (size_t t = 0; t < builder.indices.size(); ++t) {
+      auto indices = builder.indices[t];
+      for (size_t i = 0; i < 3; ++i) {
+        if (indices[i] == NOT_POOLED)
+          indices[i] = static_cast<uint32_t>(pool.weld(builder.triangles[t][i]));
+      }
+      mesh.triangles.push_back(indices);
+    }
+    mesh.ringOffsets.push_back(mesh.triangles.size());
+    mesh.ringStatuses.push_back(builder.status);
+    if (builder.status != Status::DEGENERATE)
+      result.status = std::max(result.status, builder.status);
+  }
+  mesh.vertices.assign(pool.points().begin(), pool.points().end());
+
+  if (result.status == Status::OK && mesh.triangles.empty())
+    result.status = Status::DEGENERATE;
+  if (result.status > Status::NO_PROGRESS) {
+    mesh.vertices.clear();
+    mesh.triangles.clear();
+    mesh.ringOffsets.clear();
+    mesh.ringStatuses.clear();
+  }
+  report();
+  return result;
+}
+
+BatchMesh triangulateBatch(const std::pmr::vector<Ring> &rings, const Options &options) {
+  auto result = tryTriangulateBatch(rings, options);
+  details::raiseIfFailed(result.status);
+  return std::move(result.value);
+}
+
+} // namespace ear_clip
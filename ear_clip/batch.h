@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ear_clip.h"
+
+namespace ear_clip {
+
+// The triangulations of many rings over one vertex pool, e.g. the polygons
+// of a coverage: a vertex shared by the neighbours is stored once
+struct BatchMesh {
+  // Distinct points of all the rings in the input order, then the self
+  // intersection points. The points of the removed vertices(collinear or
+  // of no area) may be unused.
+  std::pmr::vector<Point> vertices;
+  std::pmr::vector<Mesh::Indices> triangles; // one index buffer, ring by ring in the input order
+  // The triangles of the ring r are [ringOffsets[r], ringOffsets[r + 1])
+  std::pmr::vector<size_t> ringOffsets;
+  std::pmr::vector<Status> ringStatuses; // the tryTriangulate() one of each ring
+};
+
+// Triangulates the rings against the shared pool: the points are welded
+// once for the whole batch(within options.snapTolerance), so the rings get
+// the same coordinates along their common boundaries, and the rings are
+// triangulated by options.threads independently. Each ring is still
+// normalized on its own, its self intersections don't see the other rings.
+// options.simplifyTolerance is applied per ring too, so it may open gaps
+// along the shared boundaries. The memory counters of options.stats include
+// the pool and the returned mesh.
+//
+// The status is the worst ring one, but DEGENERATE only if there are no
+// triangles at all: a sliver polygon doesn't fail the batch. It's
+// INVALID_OPTIONS for a negative or NaN options.snapTolerance.
+Result<BatchMesh> tryTriangulateBatch(const std::pmr::vector<Ring> &rings, const Options &options = {}) noexcept;
+BatchMesh triangulateBatch(const std::pmr::vector<Ring> &rings, const Options &options = {});
+
+} // namespace ear_clip
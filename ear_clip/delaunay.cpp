@@ -0,0 +1,243 @@
+#include "delaunay.h"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace ear_clip {
+
+namespace {
+
+constexpr double EPSILON = 0x1p-53; // half of the double ulp of 1
+constexpr double ORIENT_ERROR_BOUND = (3.0 + 16.0 * EPSILON) * EPSILON;
+constexpr double IN_CIRCLE_ERROR_BOUND = (10.0 + 96.0 * EPSILON) * EPSILON;
+
+// Exact arithmetic on nonoverlapping expansions: the value is the sum of
+// the components, which go in the increasing magnitude order. It's slow,
+// so only the filter failures get here. The results are allocated from the
+// memory of the arguments.
+using Expansion = std::pmr::vector<double>;
+
+void twoSum(double a, double b, double &x, double &y) {
+  x = a + b;
+  double bVirtual = x - a;
+  double aVirtual = x - bVirtual;
+  y = (a - aVirtual) + (b - bVirtual);
+}
+
+// Adds the value to the expansion, zero components are dropped
+void grow(Expansion &e, double b) {
+  size_t size = 0;
+  for (double component : e) {
+    double low;
+    twoSum(b, component, b, low);
+    if (low != 0)
+      e[size++] = low;
+  }
+  e.resize(size);
+  if (b != 0)
+    e.push_back(b);
+}
+
+Expansion difference(double a, double b, std::pmr::memory_resource *memory) {
+  Expansion result(memory);
+  grow(result, a);
+  grow(result, -b);
+  return result;
+}
+
+Expansion sum(Expansion a, const Expansion &b) {
+  for (double component : b)
+    grow(a, component);
+  return a;
+}
+
+Expansion product(const Expansion &a, const Expansion &b) {
+  Expansion result(a.get_allocator());
+  for (double x : a) {
+    for (double y : b) {
+      double high = x * y;
+      grow(result, std::fma(x, y, -high));
+      grow(result, high);
+    }
+  }
+  return result;
+}
+
+Expansion negate(Expansion e) {
+  for (auto &component : e)
+    component = -component;
+  return e;
+}
+
+// The largest component has the sign of the sum
+double sign(const Expansion &e) {
+  return e.empty() ? 0 : e.back();
+}
+
+double orientExact(Point a, Point b, Point c) {
+  // A few dozens of components, so collinear input doesn't touch the heap
+  std::array<std::byte, 2048> buffer;
+  std::pmr::monotonic_buffer_resource memory(buffer.data(), buffer.size());
+  auto acx = difference(a.x, c.x, &memory), acy = difference(a.y, c.y, &memory);
+  auto bcx = difference(b.x, c.x, &memory), bcy = difference(b.y, c.y, &memory);
+  return sign(sum(product(acx, bcy), negate(product(acy, bcx))));
+}
+
+double inCircleExact(Point a, Point b, Point c, Point d) {
+  auto memory = std::pmr::get_default_resource();
+  auto adx = difference(a.x, d.x, memory), ady = difference(a.y, d.y, memory);
+  auto bdx = difference(b.x, d.x, memory), bdy = difference(b.y, d.y, memory);
+  auto cdx = difference(c.x, d.x, memory), cdy = difference(c.y, d.y, memory);
+
+  auto lift = [](const Expansion &x, const Expansion &y) { return sum(product(x, x), product(y, y)); };
+  auto cross = [](const Expansion &x0, const Expansion &y0, const Expansion &x1, const Expansion &y1) {
+    return sum(product(x0, y1), negate(product(y0, x1)));
+  };
+
+  auto det = product(lift(adx, ady), cross(bdx, bdy, cdx, cdy));
+  det = sum(std::move(det), product(lift(bdx, bdy), cross(cdx, cdy, adx, ady)));
+  det = sum(std::move(det), product(lift(cdx, cdy), cross(adx, ady, bdx, bdy)));
+  return sign(det);
+}
+
+bool sameEdge(const Mesh::Indices &t, size_t i, uint32_t from, uint32_t to) {
+  return t[i] == from && t[(i + 1) % 3] == to;
+}
+
+// Index of the edge from-to in the triangle or 3
+size_t findEdge(const Mesh::Indices &t, uint32_t from, uint32_t to) {
+  size_t i = 0;
+  while (i < 3 && !sameEdge(t, i, from, to))
+    ++i;
+  return i;
+}
+
+} // namespace
+
+namespace details {
+
+double orient(Point a, Point b, Point c) {
+  double left = (a.x - c.x) * (b.y - c.y);
+  double right = (a.y - c.y) * (b.x - c.x);
+  double det = left - right;
+  // Nothing cancels if the products have different signs(or one is 0)
+  if ((left > 0) != (right > 0) || left == 0 || right == 0)
+    return det;
+  double bound = ORIENT_ERROR_BOUND * (std::abs(left) + std::abs(right));
+  if (det > bound || -det > bound)
+    return det;
+  return orientExact(a, b, c);
+}
+
+double inCircle(Point a, Point b, Point c, Point d) {
+  double adx = a.x - d.x, ady = a.y - d.y;
+  double bdx = b.x - d.x, bdy = b.y - d.y;
+  double cdx = c.x - d.x, cdy = c.y - d.y;
+
+  double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+  double cdxady = cdx * ady, adxcdy = adx * cdy;
+  double adxbdy = adx * bdy, bdxady = bdx * ady;
+  double aLift = adx * adx + ady * ady;
+  double bLift = bdx * bdx + bdy * bdy;
+  double cLift = cdx * cdx + cdy * cdy;
+
+  double det = aLift * (bdxcdy - cdxbdy) + bLift * (cdxady - adxcdy) + cLift * (adxbdy - bdxady);
+  double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * aLift + (std::abs(cdxady) + std::abs(adxcdy)) * bLift
+      + (std::abs(adxbdy) + std::abs(bdxady)) * cLift;
+  double bound = IN_CIRCLE_ERROR_BOUND * permanent;
+  if (det > bound || -det > bound)
+    return det;
+  return inCircleExact(a, b, c, d);
+}
+
+} // namespace details
+
+size_t makeDelaunay(Mesh &mesh) {
+  using details::inCircle;
+  using details::orient;
+
+  auto &triangles = mesh.triangles;
+  auto &neighbours = mesh.neighbours;
+  auto &constrained = mesh.constrained;
+  auto point = [&mesh](uint32_t v) { return mesh.vertices[v]; };
+
+  // An edge is addressed by its ends, as the flips change the edge indices
+  struct Edge {
+    uint32_t triangle, from, to;
+  };
+  std::pmr::vector<Edge> queue(triangles.get_allocator().resource());
+  for (uint32_t t = 0; t < triangles.size(); ++t) {
+    for (size_t i = 0; i < 3; ++i) {
+      if (!constrained[t][i] && neighbours[t][i] != Mesh::NO_NEIGHBOUR && t < neighbours[t][i])
+        queue.push_back({t, triangles[t][i], triangles[t][(i + 1) % 3]});
+    }
+  }
+
+  // Redirects the neighbour of the triangle across the edge from-to
+  auto relink = [&](uint32_t triangle, uint32_t from, uint32_t to, uint32_t neighbour) {
+    if (triangle == Mesh::NO_NEIGHBOUR)
+      return;
+    auto i = findEdge(triangles[triangle], from, to);
+    if (i < 3)
+      neighbours[triangle][i] = neighbour;
+  };
+
+  size_t flips = 0;
+  while (!queue.empty()) {
+    auto edge = queue.back();
+    queue.pop_back();
+
+    auto t = edge.triangle;
+    auto i = findEdge(triangles[t], edge.from, edge.to);
+    if (i == 3 || constrained[t][i] || neighbours[t][i] == Mesh::NO_NEIGHBOUR)
+      continue; // flipped away
+    auto n = neighbours[t][i];
+    auto j = findEdge(triangles[n], edge.to, edge.from);
+    if (j == 3)
+      continue;
+
+    // t = p q r, n = q p s
+    auto p = edge.from, q = edge.to;
+    auto r = triangles[t][(i + 2) % 3], s = triangles[n][(j + 2) % 3];
+    if (r == s)
+      continue;
+    double orientation = orient(point(p), point(q), point(r));
+    if (orientation == 0)
+      continue;
+    orientation = orientation > 0 ? 1 : -1;
+    if (orientation * inCircle(point(p), point(q), point(r), point(s)) <= 0)
+      continue;
+    // Only a convex quad can be flipped
+    if (orientation * orient(point(r), point(p), point(s)) <= 0 ||
+        orientation * orient(point(s), point(q), point(r)) <= 0)
+      continue;
+
+    auto qr = neighbours[t][(i + 1) % 3], rp = neighbours[t][(i + 2) % 3];
+    auto ps = neighbours[n][(j + 1) % 3], sq = neighbours[n][(j + 2) % 3];
+    auto qrConstrained = constrained[t][(i + 1) % 3], rpConstrained = constrained[t][(i + 2) % 3];
+    auto psConstrained = constrained[n][(j + 1) % 3], sqConstrained = constrained[n][(j + 2) % 3];
+
+    // t = r p s, n = s q r
+    triangles[t] = {r, p, s};
+    neighbours[t] = {rp, ps, n};
+    constrained[t] = {rpConstrained, psConstrained, false};
+    triangles[n] = {s, q, r};
+    neighbours[n] = {sq, qr, t};
+    constrained[n] = {sqConstrained, qrConstrained, false};
+    relink(qr, r, q, n);
+    relink(ps, s, p, t);
+    flips++;
+
+    queue.push_back({t, r, p});
+    queue.push_back({t, p, s});
+    queue.push_back({n, s, q});
+    queue.push_back({n, q, r});
+  }
+
+  return flips;
+}
+
+} // namespace ear_clip
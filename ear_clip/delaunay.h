@@ -0,0 +1,28 @@
+#pragma once
+
+#include "ear_clip.h"
+
+namespace ear_clip {
+
+// Lawson edge flips over the triangulateMesh() output until it's constrained
+// Delaunay: no diagonal has the opposite vertex of its neighbour strictly
+// inside the circumcircle. The ring edges(Mesh::constrained) are never
+// flipped. The adjacency recorded by the clipping is used and kept up to
+// date, the edges to check are in a work queue, so the cost is about linear
+// on the usual inputs. Returns the flips count.
+size_t makeDelaunay(Mesh &mesh);
+
+namespace details {
+
+// Exact sign predicates: a floating point filter with the exact expansion
+// arithmetic fallback(Shewchuk)
+
+// > 0 if a, b, c are counterclockwise, < 0 - clockwise, 0 - collinear
+double orient(Point a, Point b, Point c);
+// > 0 if d is inside the circle through the counterclockwise a, b, c,
+// < 0 - outside, 0 - on it. The sign is inverted for the clockwise a, b, c.
+double inCircle(Point a, Point b, Point c, Point d);
+
+} // namespace details
+
+} // namespace ear_clip
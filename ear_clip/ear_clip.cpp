@@ -1,13 +1,19 @@
 #include "ear_clip.h"
+#include "intersection_search.h"
+#include "memory_resources.h"
+#include "planar_graph.h"
+#include "point_welder.h"
+#include "simplify.h"
 
 #include <algorithm>
-#include <exception>
+#include <atomic>
 #include <optional>
 #include <map>
 #include <numeric>
 #include <cmath>
 #include <iostream>
 #include <fstream>
+#include <thread>
 
 namespace ear_clip {
 
@@ -25,57 +31,261 @@ std::ostream &operator<<(std::ostream &s, const Ring &polygon) {
   return s;
 }
 
-template<class T>
-std::ostream &operator<<(std::ostream &s, const std::vector<T> &v) {
+template<class T, class A>
+std::ostream &operator<<(std::ostream &s, const std::vector<T, A> &v) {
   for (auto i : v)
     s << i << ' ';
 
   return s;
 }
 
-bool traceEnabled = true;
+// Read by the worker threads, the flag orders nothing
+std::atomic<bool> traceEnabled = true;
 
 std::ostream &trace() {
-  static class NullBuffer : public std::streambuf {
-   public:
-    int overflow(int c) { return c; }
-  } nullBuffer;
+  // A stream without a buffer is bad, so the disabled trace isn't even formatted.
+  // Each << sets its state, so it's one per thread.
+  thread_local std::ostream nullStream(nullptr);
 
-  static std::ostream nullStream(&nullBuffer);
+  return traceEnabled.load(std::memory_order_relaxed) ? std::cerr : nullStream;
+}
+
+// Adds the scope wall time to the target duration. Does nothing(even doesn't
+// read the clock) if there is no target.
+class PhaseTimer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit PhaseTimer(TriangulationStats::Duration *target)
+      : target(target) {
+    if (target)
+      start = Clock::now();
+  }
+
+  ~PhaseTimer() {
+    if (target)
+      *target += std::chrono::duration_cast<TriangulationStats::Duration>(Clock::now() - start);
+  }
+
+  PhaseTimer(const PhaseTimer &) = delete;
+  PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+ private:
+  TriangulationStats::Duration *target;
+  Clock::time_point start;
+};
+
+TriangulationStats::Duration *phase(TriangulationStats *stats,
+                                    TriangulationStats::Duration TriangulationStats::*member) {
+  return stats ? &(stats->*member) : nullptr;
+}
+
+void count(TriangulationStats *stats, size_t TriangulationStats::*member, size_t value = 1) {
+  if (stats)
+    stats->*member += value;
+}
 
-  return traceEnabled ? std::cerr : nullStream;
+std::pmr::memory_resource *memoryResource(const Options &options) {
+  return options.memory ? options.memory : std::pmr::get_default_resource();
 }
 
+// The list node of std::list<Point>
+constexpr size_t RING_NODE_SIZE = sizeof(Point) + 2 * sizeof(void *);
+
+// Smaller inputs aren't worth starting threads for(if their count isn't set explicitly)
+constexpr size_t PARALLEL_MIN_VERTICES = 4096;
+// Triangulator::step() work between the clock checks of a timed step
+constexpr size_t TIMED_STEP_WORK = 1024;
+
 } // namespace
 
-void enableTrace(bool enable) {
-  traceEnabled = enable;
+namespace details {
+namespace {
+// scratch - temporary containers memory, output - the result memory.
+// status - OK, CANCELLED or NUMERIC_FAILURE, the result is empty unless it's OK.
+Ring normalize(Ring ring, const Options &options,
+               std::pmr::memory_resource *scratch, std::pmr::memory_resource *output, Status &status);
+std::pmr::vector<Ring> normalizeToFaces(Ring ring, FillRule fillRule, const Options &options,
+                                        std::pmr::memory_resource *scratch, std::pmr::memory_resource *output,
+                                        Status &status);
+} // namespace
+} // namespace details
+
+namespace {
+
+bool cancelled(const std::atomic<bool> *cancel) {
+  return cancel && cancel->load(std::memory_order_relaxed);
 }
 
-std::vector<Triangle> triangulate(Ring ring) {
-  trace() << "triangulate: Source ring: " << ring << '\n';
-  ring = details::normalizeRing(std::move(ring));
-  trace() << "triangulate: Normalised ring: " << ring << '\n';
+const Point &point(const Point &p) { return p; }
+
+// A ring node of the mesh output. halfEdge - the half-edge(triangle * 3 + edge)
+// on the other side of the edge to the next node, NO_HALF_EDGE if it's a ring edge.
+struct MeshNode {
+  Point point;
+  uint32_t vertex;
+  uint32_t halfEdge;
+};
+
+constexpr uint32_t NO_HALF_EDGE = UINT32_MAX;
 
+const Point &point(const MeshNode &node) { return node.point; }
+
+// Orientation of the ring by its highest vertex
+template <class Node>
+details::VertexOrder ringVertexOrder(const std::pmr::list<Node> &ring) {
   if (ring.size() < 3)
-    return {};
+    details::raise<std::invalid_argument>("Ring has less than 3 points");
+
+  auto highest = std::max_element(ring.begin(), ring.end(),
+                                  [](const auto &l, const auto &r) { return point(l).y < point(r).y; });
+
+  auto prev = highest == ring.begin() ? std::prev(ring.end()) : std::prev(highest);
+  auto next = std::next(highest);
+  if (next == ring.end())
+    next = ring.begin();
+
+  Triangle triangle = {point(*prev), point(*highest), point(*next)};
+  return details::vertexOrder(triangle);
+}
+
+// Ear clipping of a normalized ring, which may be done in parts.
+// clipped(a, b, c, triangle) is called for each clipped ear before b is erased.
+// loopRemoved(x, y, z) is called before the zero area loop y, z(*x == *z) is erased.
+template <class Node, class Clipped, class LoopRemoved>
+class RingClipper {
+ public:
+  using Iterator = typename std::pmr::list<Node>::iterator;
+
+  RingClipper(std::pmr::list<Node> &ring, TriangulationStats *stats, const std::atomic<bool> *cancel,
+              Clipped clipped, LoopRemoved loopRemoved)
+      : ring(ring), stats(stats), cancel(cancel), clipped(std::move(clipped)), loopRemoved(std::move(loopRemoved)) {}
+
+  // Clips until the work(an ear candidate or a point tested against it) is
+  // spent. The empty loops removal pass over the whole ring is one unit.
+  // Returns OK, NO_PROGRESS or CANCELLED once the ring is done.
+  std::optional<Status> advance(size_t &work) {
+    if (status)
+      return status;
+    auto spend = [&work](size_t units) { work -= std::min(work, units); };
+    using namespace details;
+
+    if (!started) {
+      started = true;
+      if (ring.size() < 3)
+        return status = Status::OK;
+
+      spend(ring.size());
+      for (auto it = ring.begin(); it != ring.end(); ++it) {
+        it = removeEmptyLoops(it);
+      }
+
+      if (ring.size() < 3)
+        return status = Status::OK;
+
+      ringOrder = ringVertexOrder(ring);
+      a = ring.begin();
+    }
+
+    // The clip time shouldn't include the empty loops removal, which is measured separately
+    auto emptyLoopTimeBefore = stats ? stats->emptyLoopTime : TriangulationStats::Duration{};
+    auto clipStart = stats ? PhaseTimer::Clock::now() : PhaseTimer::Clock::time_point{};
+    auto addClipTime = [&]() {
+      if (stats) {
+        stats->clipTime += std::chrono::duration_cast<TriangulationStats::Duration>(PhaseTimer::Clock::now() - clipStart)
+            - (stats->emptyLoopTime - emptyLoopTimeBefore);
+      }
+    };
+
+    while (ring.size() > 2 && counter < ring.size()) {
+      if (work == 0) {
+        addClipTime();
+        return std::nullopt;
+      }
+      if (cancelled(cancel))
+        return status = Status::CANCELLED;
+      spend(1);
+      counter++;
+      {
+        auto size = ring.size();
+        a = removeEmptyLoops(a);
+        if (size != ring.size()) {
+          counter = 0;
+          count(stats, &TriangulationStats::counterResets);
+          trace() << "Removed " << size - ring.size() << " empty loops\n";
+        }
+      }
+
+      auto b = nextIt(a);
+      auto c = nextIt(b);
+
+      trace() << "Triangle: (" << point(*a) << ")-(" << point(*b) << ")-(" << point(*c) << ")\n";
+
+      Triangle t{point(*a), point(*b), point(*c)};
+      auto triangleVertexOrder = vertexOrder(t);
+      if (triangleVertexOrder == VertexOrder::NO_AREA) { // Triangle - line (ex. 0 0, 1 1, 2 2)
+        count(stats, &TriangulationStats::rejectedEars);
+        a = nextIt(a);
+        continue;
+      }
 
+      bool isEar = triangleVertexOrder == ringOrder;
+      if (isEar) {
+        trace() << "Ear rotation. ";
+        for (auto vIt = nextIt(c); vIt != a; vIt = nextIt(vIt)) {
+          const Point &p = point(*vIt);
+          count(stats, &TriangulationStats::pointInTriangleCalls);
+          spend(1);
+          if (pointInTriangle(t, p)) {
+            isEar = false;
+            trace() << "Contains other points. ";
+            break;
+          }
+        }
+      }
+
+      if (isEar) {
+        trace() << "clip.\n";
+        clipped(a, b, c, t);
+        ring.erase(b);
+        counter = 0;
+        count(stats, &TriangulationStats::counterResets);
+      } else {
+        trace() << "skip.\n";
+        count(stats, &TriangulationStats::rejectedEars);
+        a = nextIt(a);
+      }
+    }
+    addClipTime();
+
+    // The rest is fine if it's collinear
+    for (auto it = ring.begin(); ring.size() > 2 && it != ring.end(); ++it) {
+      auto next = nextIt(it);
+      if (vertexOrder(Triangle{point(*it), point(*next), point(*nextIt(next))}) != VertexOrder::NO_AREA)
+        return status = Status::NO_PROGRESS;
+    }
+    return status = Status::OK;
+  }
+
+ private:
   // Helpers to iterate over a cycled array:
-  auto nextIt = [&ring](const auto &it) {
+  Iterator nextIt(Iterator it) const {
     auto next = std::next(it);
-    return next == ring.end() ? next = ring.begin() : next;
-  };
-  auto prevIt = [&ring](const auto &it) {
+    return next == ring.end() ? ring.begin() : next;
+  }
+  Iterator prevIt(Iterator it) const {
     return it == ring.begin() ? std::prev(ring.end()) : std::prev(it);
-  };
+  }
 
-  auto removeEmptyLoops = [&](auto a) {
+  Iterator removeEmptyLoops(Iterator a) {
+    PhaseTimer timer(phase(stats, &TriangulationStats::emptyLoopTime));
     bool changed = true;
     while (changed && ring.size() > 3) {
       changed = false;
       auto b = nextIt(a);
       auto c = nextIt(b);
-      if (*a == *c) {
+      if (point(*a) == point(*c)) {
+        loopRemoved(a, b, c);
         ring.erase(b);
         ring.erase(c);
         changed = true;
@@ -84,7 +294,8 @@ std::vector<Triangle> triangulate(Ring ring) {
         return a;
       b = prevIt(a);
       c = nextIt(a);
-      if (*b == *c) {
+      if (point(*b) == point(*c)) {
+        loopRemoved(b, a, c);
         ring.erase(a);
         ring.erase(c);
         a = b;
@@ -94,7 +305,8 @@ std::vector<Triangle> triangulate(Ring ring) {
         return a;
       b = prevIt(a);
       c = prevIt(b);
-      if (*c == *a) {
+      if (point(*c) == point(*a)) {
+        loopRemoved(c, b, a);
         ring.erase(a);
         ring.erase(b);
         a = c;
@@ -102,73 +314,394 @@ std::vector<Triangle> triangulate(Ring ring) {
       }
     }
     return a;
+  }
+
+  std::pmr::list<Node> &ring;
+  TriangulationStats *stats;
+  const std::atomic<bool> *cancel;
+  Clipped clipped;
+  LoopRemoved loopRemoved;
+
+  bool started = false;
+  std::optional<Status> status;
+  details::VertexOrder ringOrder = details::VertexOrder::NO_AREA;
+  Iterator a;
+  size_t counter = 0; // ears tested since the last clip
+};
+
+// Clips the whole ring, returns OK, NO_PROGRESS or CANCELLED
+template <class Node, class Clipped, class LoopRemoved>
+Status clipRing(std::pmr::list<Node> &ring, TriangulationStats *stats, const std::atomic<bool> *cancel,
+                Clipped clipped, LoopRemoved loopRemoved) {
+  RingClipper<Node, Clipped, LoopRemoved> clipper(ring, stats, cancel, std::move(clipped), std::move(loopRemoved));
+  size_t work = SIZE_MAX;
+  return *clipper.advance(work);
+}
+
+// The clipped triangles are appended to the result
+struct AppendTriangles {
+  Triangles *result;
+  void operator()(Ring::iterator, Ring::iterator, Ring::iterator, const Triangle &t) const { result->push_back(t); }
+};
+
+struct IgnoreLoops {
+  void operator()(Ring::iterator, Ring::iterator, Ring::iterator) const {}
+};
+
+using TrianglesClipper = RingClipper<Point, AppendTriangles, IgnoreLoops>;
+
+// The triangles are appended to the result
+Status clipRing(Ring &ring, TriangulationStats *stats, const std::atomic<bool> *cancel, Triangles &result) {
+  return clipRing(ring, stats, cancel, AppendTriangles{&result}, IgnoreLoops{});
+}
+
+// Clips the ring into the mesh, linking the triangles across the diagonals.
+// The half-edges which are left unlinked are appended to open.
+Status clipRing(std::pmr::list<MeshNode> &ring, TriangulationStats *stats, const std::atomic<bool> *cancel,
+                Mesh &mesh, std::pmr::vector<uint32_t> &open) {
+  auto link = [&mesh](uint32_t from, uint32_t to) {
+    if (from != NO_HALF_EDGE)
+      mesh.neighbours[from / 3][from % 3] = to == NO_HALF_EDGE ? Mesh::NO_NEIGHBOUR : to / 3;
+  };
+  auto linkBoth = [&](uint32_t l, uint32_t r) {
+    if (l == NO_HALF_EDGE || r == NO_HALF_EDGE) {
+      // The other side is a ring edge
+      if (l != NO_HALF_EDGE)
+        open.push_back(l);
+      if (r != NO_HALF_EDGE)
+        open.push_back(r);
+      return;
+    }
+    link(l, r);
+    link(r, l);
   };
 
-  for (auto it = ring.begin(); it != ring.end(); ++it) {
-    it = removeEmptyLoops(it);
+  auto status = clipRing(
+      ring, stats, cancel,
+      [&](auto a, auto b, auto c, const Triangle &) {
+        auto triangle = static_cast<uint32_t>(mesh.triangles.size());
+        mesh.triangles.push_back({a->vertex, b->vertex, c->vertex});
+        mesh.neighbours.push_back({Mesh::NO_NEIGHBOUR, Mesh::NO_NEIGHBOUR, Mesh::NO_NEIGHBOUR});
+        mesh.constrained.push_back({true, true, true});
+        // The edges a-b, b-c are linked to the triangles they were clipped from
+        // and c-a becomes the ring edge
+        for (auto [edge, other] : {std::pair(triangle * 3, a->halfEdge), std::pair(triangle * 3 + 1, b->halfEdge)}) {
+          linkBoth(edge, other);
+          if (other != NO_HALF_EDGE) // a diagonal
+            mesh.constrained[triangle][edge % 3] = mesh.constrained[other / 3][other % 3] = false;
+        }
+        a->halfEdge = triangle * 3 + 2;
+      },
+      [&](auto x, auto y, auto z) {
+        // x-y and y-z are the same segment, the triangles on their other sides are adjacent
+        linkBoth(x->halfEdge, y->halfEdge);
+        x->halfEdge = z->halfEdge;
+      });
+
+  // The edges of the rest(a degenerate or unclippable ring) stay open
+  for (const auto &node : ring) {
+    if (node.halfEdge != NO_HALF_EDGE)
+      open.push_back(node.halfEdge);
   }
+  return status;
+}
 
-  if (ring.size() < 3)
-    return {};
-
-  auto ringVertexOrder = details::vertexOrder(ring);
-  std::vector<Triangle> result;
-  result.reserve(ring.size() - 2);
-  using namespace details;
-  auto a = ring.begin();
-  size_t counter = 0;
-  while (ring.size() > 2 && counter < ring.size()) {
-    counter++;
-    {
-      auto size = ring.size();
-      a = removeEmptyLoops(a);
-      if (size != ring.size()) {
-        counter = 0;
-        trace() << "Removed " << size - ring.size() << " empty loops\n";
+// Links the open half-edges which are the same edge in the opposite directions
+void linkOpenEdges(Mesh &mesh, std::pmr::vector<uint32_t> &open) {
+  auto from = [&mesh](uint32_t h) { return mesh.triangles[h / 3][h % 3]; };
+  auto to = [&mesh](uint32_t h) { return mesh.triangles[h / 3][(h % 3 + 1) % 3]; };
+  // By value: std::minmax() would return the references to the temporaries
+  auto edge = [&](uint32_t h) {
+    auto f = from(h), t = to(h);
+    return std::pair(std::min(f, t), std::max(f, t));
+  };
+  std::sort(open.begin(), open.end(), [&](uint32_t l, uint32_t r) {
+    return std::pair(edge(l), l) < std::pair(edge(r), r);
+  });
+
+  for (size_t begin = 0, end = 0; begin < open.size(); begin = end) {
+    auto shared = edge(open[begin]);
+    for (end = begin + 1; end < open.size() && edge(open[end]) == shared; ++end) {
+    }
+
+    // Usually a pair, more if the ring passes the segment several times
+    for (auto i = begin; i < end; ++i) {
+      auto l = open[i];
+      if (mesh.neighbours[l / 3][l % 3] != Mesh::NO_NEIGHBOUR)
+        continue;
+      for (auto j = i + 1; j < end; ++j) {
+        auto r = open[j];
+        if (from(r) == to(l) && l / 3 != r / 3 && mesh.neighbours[r / 3][r % 3] == Mesh::NO_NEIGHBOUR) {
+          mesh.neighbours[l / 3][l % 3] = r / 3;
+          mesh.neighbours[r / 3][r % 3] = l / 3;
+          break;
+        }
       }
     }
+  }
+}
 
-    auto b = nextIt(a);
-    auto c = nextIt(b);
+// The optional simplification pre-pass
+void simplifyRing(Ring &ring, const Options &options, std::pmr::memory_resource *memory) {
+  if (!options.simplifyTolerance)
+    return;
 
-    trace() << "Triangle: (" << *a << ")-(" << *b << ")-(" << *c << ")\n";
+  PhaseTimer timer(phase(options.stats, &TriangulationStats::simplifyTime));
+  auto size = ring.size();
+  ring = simplify(std::move(ring), *options.simplifyTolerance, memory);
+  count(options.stats, &TriangulationStats::simplifiedPoints, size - ring.size());
+  trace() << "Simplified ring: " << ring << '\n';
+}
 
-    Triangle t{*a, *b, *c};
-    auto triangleVertexOrder = vertexOrder(t);
-    if (triangleVertexOrder == VertexOrder::NO_AREA) { // Triangle - line (ex. 0 0, 1 1, 2 2)
-      a = nextIt(a);
-      continue;
+// The self intersection search threads
+size_t intersectionThreads(const Options &options, size_t edges) {
+  auto threads = options.threads;
+  if (threads == 0)
+    threads = edges < PARALLEL_MIN_VERTICES ? 1 : std::thread::hardware_concurrency();
+
+  return std::max<size_t>(threads, 1);
+}
+
+size_t workerThreads(const Options &options, size_t faces, size_t vertices) {
+  auto threads = options.threads;
+  if (threads == 0)
+    threads = vertices < PARALLEL_MIN_VERTICES ? 1 : std::thread::hardware_concurrency();
+
+  return std::clamp<size_t>(threads, 1, faces);
+}
+
+// Triangulates the faces with the worker threads, the triangles are appended
+// to the result in the faces order. memory must be thread safe.
+Status clipFaces(std::pmr::vector<Ring> &faces, size_t threads, const Options &options,
+                 std::pmr::memory_resource *memory, Triangles &result) {
+  auto stats = options.stats;
+  std::pmr::vector<Triangles> faceTriangles(faces.size(), memory);
+  std::pmr::vector<TriangulationStats> threadStats(threads, memory);
+  std::pmr::vector<Status> statuses(threads, Status::OK, memory);
+  std::atomic<size_t> nextFace = 0;
+
+  auto work = [&](size_t thread) {
+    for (auto face = nextFace++; face < faces.size(); face = nextFace++) {
+      if (faces[face].size() > 2)
+        faceTriangles[face].reserve(faces[face].size() - 2);
+      auto status = clipRing(faces[face], stats ? &threadStats[thread] : nullptr, options.cancel, faceTriangles[face]);
+      statuses[thread] = std::max(statuses[thread], status);
     }
+  };
+
+  {
+    std::pmr::vector<std::thread> workers(memory);
+    workers.reserve(threads - 1);
+    for (size_t thread = 1; thread < threads; ++thread)
+      workers.emplace_back(work, thread);
+    work(0);
+    for (auto &worker : workers)
+      worker.join();
+  }
+
+  if (stats) {
+    for (const auto &s : threadStats)
+      details::merge(*stats, s);
+  }
+
+  size_t total = 0;
+  for (const auto &ts : faceTriangles)
+    total += ts.size();
+  result.reserve(total);
+  for (const auto &ts : faceTriangles)
+    result.insert(result.end(), ts.begin(), ts.end());
+  return *std::max_element(statuses.begin(), statuses.end());
+}
+
+} // namespace
+
+void enableTrace(bool enable) {
+  traceEnabled.store(enable, std::memory_order_relaxed);
+}
+
+const char *describe(Status status) noexcept {
+  switch (status) {
+    case Status::OK:return "OK";
+    case Status::DEGENERATE:return "The ring has no area";
+    case Status::NO_PROGRESS:return "No ear is found";
+    case Status::CANCELLED:return "Triangulation is cancelled";
+    case Status::NUMERIC_FAILURE:return "There are no intersection";
+    case Status::INVALID_OPTIONS:return "Invalid options";
+  }
+  return "Unknown status";
+}
 
-    bool isEar = triangleVertexOrder == ringVertexOrder;
-    if (isEar) {
-      trace() << "Ear rotation. ";
-      for (auto vIt = nextIt(c); vIt != a; vIt = nextIt(vIt)) {
-        const Point &p = *vIt;
-        if (pointInTriangle(t, p)) {
-          isEar = false;
-          trace() << "Contains other points. ";
+Result<Triangles> tryTriangulate(Ring sourceRing, const Options &options) noexcept {
+  auto stats = options.stats;
+  auto memory = memoryResource(options);
+  details::CountingResource countingMemory(memory);
+  auto scratch = stats ? &countingMemory : memory;
+  Result<Triangles> result{Status::OK, Triangles(memory)};
+  if (!(options.snapTolerance >= 0)) {
+    result.status = Status::INVALID_OPTIONS;
+    return result;
+  }
+
+  trace() << "triangulate: Source ring: " << sourceRing << '\n';
+  simplifyRing(sourceRing, options, scratch);
+  auto &triangles = result.value;
+  if (!options.fillRule) {
+    auto ring = details::normalize(std::move(sourceRing), options, scratch, scratch, result.status);
+    trace() << "triangulate: Normalised ring: " << ring << '\n';
+    if (ring.size() > 2)
+      triangles.reserve(ring.size() - 2); // each clip removes a vertex, so it's the only allocation
+    if (result.status == Status::OK)
+      result.status = clipRing(ring, stats, options.cancel, triangles);
+  } else {
+    // The faces can be clipped in parallel, so the memory is shared between threads
+    details::LockingResource sharedMemory(scratch);
+    auto parallel = options.threads != 1;
+    auto faces = details::normalizeToFaces(std::move(sourceRing), *options.fillRule, options,
+                                           parallel ? &sharedMemory : scratch, parallel ? &sharedMemory : scratch,
+                                           result.status);
+    size_t vertices = 0;
+    for (const auto &face : faces)
+      vertices += face.size();
+    trace() << "triangulate: " << faces.size() << " faces, " << vertices << " vertices\n";
+
+    auto threads = workerThreads(options, faces.size(), vertices);
+    if (threads > 1) {
+      result.status = clipFaces(faces, threads, options, &sharedMemory, triangles);
+    } else {
+      if (vertices > 2 * faces.size())
+        triangles.reserve(vertices - 2 * faces.size());
+      for (auto &face : faces) {
+        if (result.status == Status::CANCELLED)
           break;
-        }
+        result.status = std::max(result.status, clipRing(face, stats, options.cancel, triangles));
       }
     }
+  }
 
-    if (isEar) {
-      trace() << "clip.\n";
-      result.push_back(t);
-      ring.erase(b);
-      counter = 0;
-    } else {
-      trace() << "skip.\n";
-      a = nextIt(a);
+  if (result.status == Status::OK && triangles.empty())
+    result.status = Status::DEGENERATE;
+  if (result.status > Status::NO_PROGRESS)
+    triangles.clear();
+
+  if (stats) {
+    if (triangles.capacity() != 0)
+      countingMemory.account(triangles.capacity() * sizeof(Triangle));
+    countingMemory.report(*stats);
+  }
+
+  return result;
+}
+
+Triangles triangulate(Ring ring, const Options &options) {
+  auto result = tryTriangulate(std::move(ring), options);
+  details::raiseIfFailed(result.status);
+  return std::move(result.value);
+}
+
+Result<Mesh> tryTriangulateMesh(Ring sourceRing, const Options &options) noexcept {
+  auto stats = options.stats;
+  auto memory = memoryResource(options);
+  details::CountingResource countingMemory(memory);
+  auto scratch = stats ? &countingMemory : memory;
+  Result<Mesh> result{Status::OK,
+                      Mesh{std::pmr::vector<Point>(memory), std::pmr::vector<Mesh::Indices>(memory),
+                           std::pmr::vector<Mesh::Indices>(memory), std::pmr::vector<Mesh::Flags>(memory)}};
+  if (!(options.snapTolerance >= 0)) {
+    result.status = Status::INVALID_OPTIONS;
+    return result;
+  }
+
+  auto &mesh = result.value;
+  trace() << "triangulateMesh: Source ring: " << sourceRing << '\n';
+  simplifyRing(sourceRing, options, scratch);
+  std::pmr::vector<Ring> faces(scratch);
+  if (!options.fillRule)
+    faces.push_back(details::normalize(std::move(sourceRing), options, scratch, scratch, result.status));
+  else
+    faces = details::normalizeToFaces(std::move(sourceRing), *options.fillRule, options, scratch, scratch,
+                                      result.status);
+
+  size_t vertices = 0;
+  for (const auto &face : faces)
+    vertices += face.size();
+  details::PointWelder welder(0, scratch);
+  welder.reserve(vertices);
+  if (vertices > 2 * faces.size()) {
+    mesh.triangles.reserve(vertices - 2 * faces.size());
+    mesh.neighbours.reserve(vertices - 2 * faces.size());
+    mesh.constrained.reserve(vertices - 2 * faces.size());
+  }
+
+  std::pmr::vector<uint32_t> open(scratch);
+  std::pmr::list<MeshNode> ring(scratch);
+  for (const auto &face : faces) {
+    if (result.status == Status::CANCELLED)
+      break;
+    ring.clear();
+    for (const auto &p : face)
+      ring.push_back({p, static_cast<uint32_t>(welder.weld(p)), NO_HALF_EDGE});
+    result.status = std::max(result.status, clipRing(ring, stats, options.cancel, mesh, open));
+  }
+  if (result.status == Status::OK && mesh.triangles.empty())
+    result.status = Status::DEGENERATE;
+  if (result.status > Status::NO_PROGRESS) {
+    mesh.triangles.clear();
+    mesh.neighbours.clear();
+    mesh.constrained.clear();
+  } else {
+    linkOpenEdges(mesh, open);
+    mesh.vertices.assign(welder.points().begin(), welder.points().end());
+  }
+
+  if (stats) {
+    if (mesh.vertices.capacity() != 0)
+      countingMemory.account(mesh.vertices.capacity() * sizeof(Point));
+    for (const auto *indices : {&mesh.triangles, &mesh.neighbours}) {
+      if (indices->capacity() != 0)
+        countingMemory.account(indices->capacity() * sizeof(Mesh::Indices));
     }
+    if (mesh.constrained.capacity() != 0)
+      countingMemory.account(mesh.constrained.capacity() * sizeof(Mesh::Flags));
+    countingMemory.report(*stats);
   }
 
   return result;
 }
 
+Mesh triangulateMesh(Ring ring, const Options &options) {
+  auto result = tryTriangulateMesh(std::move(ring), options);
+  details::raiseIfFailed(result.status);
+  return std::move(result.value);
+}
+
 namespace details {
 
+void merge(TriangulationStats &to, const TriangulationStats &from) {
+  to.dedupTime += from.dedupTime;
+  to.intersectionTime += from.intersectionTime;
+  to.traversalTime += from.traversalTime;
+  to.simplifyTime += from.simplifyTime;
+  to.emptyLoopTime += from.emptyLoopTime;
+  to.clipTime += from.clipTime;
+  to.pointInTriangleCalls += from.pointInTriangleCalls;
+  to.rejectedEars += from.rejectedEars;
+  to.counterResets += from.counterResets;
+  to.splitPoints += from.splitPoints;
+  to.simplifiedPoints += from.simplifiedPoints;
+  to.allocations += from.allocations;
+  to.allocatedBytes += from.allocatedBytes;
+  to.peakBytes = std::max(to.peakBytes, from.peakBytes);
+}
+
+void raiseIfFailed(Status status) {
+  switch (status) {
+    case Status::CANCELLED:raise<Cancelled>();
+    case Status::NUMERIC_FAILURE:raise<std::logic_error>(describe(status));
+    case Status::INVALID_OPTIONS:raise<std::invalid_argument>(describe(status));
+    default:break;
+  }
+}
+
 namespace {
 double signedArea(const Point &a, const Point &b, const Point &c) {
   auto area = (c.y - b.y) * (a.x - c.x) - (c.x - b.x) * (a.y - c.y);
@@ -177,19 +710,7 @@ double signedArea(const Point &a, const Point &b, const Point &c) {
 } // namespace
 
 VertexOrder vertexOrder(const Ring &ring) {
-  if (ring.size() < 3)
-    throw std::invalid_argument("Ring has less than 3 points");
-
-  auto highest = std::max_element(ring.begin(), ring.end(),
-                                  [](auto l, auto r) { return l.y < r.y; });
-
-  auto prev = highest == ring.begin() ? std::prev(ring.end()) : std::prev(highest);
-  auto next = std::next(highest);
-  if (next == ring.end())
-    next = ring.begin();
-
-  Triangle triangle = {*prev, *highest, *next};
-  return vertexOrder(triangle);
+  return ringVertexOrder(ring);
 }
 
 VertexOrder vertexOrder(const ear_clip::Triangle &triangle) {
@@ -222,6 +743,13 @@ bool intersects(Point a, Point b, Point c, Point d) {
 }
 
 Point intersection(Point a, Point b, Point c, Point d) {
+  auto result = tryIntersection(a, b, c, d);
+  if (!result)
+    raise<std::logic_error>(describe(Status::NUMERIC_FAILURE));
+  return *result;
+}
+
+std::optional<Point> tryIntersection(Point a, Point b, Point c, Point d) noexcept {
   double a1 = b.y - a.y;
   double b1 = a.x - b.x;
   double c1 = a1 * a.x + b1 * a.y;
@@ -232,44 +760,81 @@ Point intersection(Point a, Point b, Point c, Point d) {
 
   double det = a1 * b2 - a2 * b1;
   if (det == 0)
-    throw std::logic_error("There are no intersection");
+    return std::nullopt;
 
   double x = (b2 * c1 - b1 * c2) / det;
   double y = (a1 * c2 - a2 * c1) / det;
-  return {x, y};
+  return Point{x, y};
 }
 
-Ring normalizeRing(Ring ring) {
-  if (ring.size() < 2)
-    return ring;
+Ring normalizeRing(Ring ring, const Options &options) {
+  auto memory = memoryResource(options);
+  auto status = Status::OK;
+  if (!options.stats) {
+    auto result = normalize(std::move(ring), options, memory, memory, status);
+    details::raiseIfFailed(status);
+    return result;
+  }
 
-  if (ring.back() == ring.front()) {
-    ring.pop_back();
-    if (ring.size() == 1)
-      return {};
+  details::CountingResource countingMemory(memory);
+  auto result = normalize(std::move(ring), options, &countingMemory, memory, status);
+  countingMemory.account(result.size() * RING_NODE_SIZE, result.size());
+  countingMemory.report(*options.stats);
+  details::raiseIfFailed(status);
+  return result;
+}
+
+std::pmr::vector<Ring> normalizeFaces(Ring ring, FillRule fillRule, const Options &options) {
+  auto memory = memoryResource(options);
+  auto status = Status::OK;
+  if (!options.stats) {
+    auto result = normalizeToFaces(std::move(ring), fillRule, options, memory, memory, status);
+    details::raiseIfFailed(status);
+    return result;
   }
 
+  details::CountingResource countingMemory(memory);
+  auto result = normalizeToFaces(std::move(ring), fillRule, options, &countingMemory, memory, status);
+  countingMemory.account(result.capacity() * sizeof(Ring));
+  for (const auto &face : result)
+    countingMemory.account(face.size() * RING_NODE_SIZE, face.size());
+  countingMemory.report(*options.stats);
+  details::raiseIfFailed(status);
+  return result;
+}
+
+namespace {
+
+// The ring cut at its self intersections
+struct SplitRing {
+  SplitRing(double tolerance, std::pmr::memory_resource *memory)
+      : welder(tolerance, memory), edges(memory) {}
+
+  PointWelder welder;       // nodes, an element index is the node id
+  PlanarGraph::Edges edges; // directed as the ring goes, std::nullopt - a split edge
+};
+
+// The ring nodes and edges, and the segments to search the crossings of.
+// ring - at least 2 points, the first one isn't repeated at the end.
+void prepareSplit(const Ring &ring, const Options &options, SplitRing &result, std::pmr::vector<Segment> &segments) {
+  auto stats = options.stats;
+  std::optional<PhaseTimer> timer;
+  timer.emplace(phase(stats, &TriangulationStats::dedupTime));
+
   // nodes - nodes list, an element index in the array is the node id
-  // pointToNode - is a map (Point -> Point Id(index in nodes)
-  std::vector<Point> nodes;
-  nodes.reserve(ring.size());
-  std::map<Point, size_t> pointToNode;
+  // welder - maps a point to its id(index in nodes)
+  auto &welder = result.welder;
+  welder.reserve(ring.size());
+  const auto &nodes = welder.points();
   auto getPointId = [&](Point p) {
-    if (auto it = pointToNode.find(p); it != pointToNode.end()) {
-      return it->second;
-    }
-
-    auto index = nodes.size();
-    nodes.push_back(p);
-    pointToNode[p] = index;
-    return index;
+    return welder.weld(p);
   };
 
   // initialize nodes and pointToNode. It's not necessary but makes debug simple
   for (auto p : ring)
     getPointId(p);
 
-  std::vector<std::optional<std::pair<size_t/*from*/, size_t/*to*/>>> edges;
+  auto &edges = result.edges;
   for (auto b = ring.begin(), e = std::next(ring.begin()); e != ring.end(); b++, e++) {
     auto edge = std::make_pair(getPointId(*b), getPointId(*e));
     if (edge.first == edge.second)
@@ -278,24 +843,44 @@ Ring normalizeRing(Ring ring) {
     edges.emplace_back(edge);
   }
   auto args = std::make_pair(
-      getPointId(ring.front()), getPointId(ring.back()));
-  edges.emplace_back(args);
+      getPointId(ring.back()), getPointId(ring.front()));
+  // The closing edge goes from the back to the front, but the split points
+  // have always been computed for it from the front to the back
+  size_t closingEdge = SIZE_MAX;
+  if (args.first != args.second || edges.empty()) { // the ends can be welded(a single point keeps its loop)
+    closingEdge = edges.size();
+    edges.emplace_back(args);
+  }
 
-  std::map<size_t, std::vector<Point>> edgeToSplitPoints;
+  timer.emplace(phase(stats, &TriangulationStats::intersectionTime));
+  segments.reserve(edges.size());
   for (size_t i = 0; i < edges.size(); ++i) {
-    for (size_t j = i + 1; j < edges.size(); ++j) {
-      auto a = nodes[edges[i]->first];
-      auto b = nodes[edges[i]->second];
-      auto c = nodes[edges[j]->first];
-      auto d = nodes[edges[j]->second];
-      if (intersects(a, b, c, d)) {
-        auto p = intersection(a, b, c, d);
-        getPointId(p); // store to nodes storage
-        edgeToSplitPoints[i].push_back(p);
-        edgeToSplitPoints[j].push_back(p);
-      }
-    }
+    auto [from, to] = *edges[i];
+    if (i == closingEdge)
+      std::swap(from, to);
+    segments.push_back({nodes[from], nodes[to]});
+  }
+}
+
+// Splits the edges at the crossings of their segments
+void applyCrossings(const std::pmr::vector<Crossing> &crossings, const Options &options, SplitRing &result) {
+  auto stats = options.stats;
+  auto scratch = result.edges.get_allocator().resource();
+  PhaseTimer timer(phase(stats, &TriangulationStats::traversalTime));
+  auto &welder = result.welder;
+  const auto &nodes = welder.points();
+  auto &edges = result.edges;
+  auto getPointId = [&](Point p) {
+    return welder.weld(p);
+  };
+
+  std::pmr::map<size_t, std::pmr::vector<Point>> edgeToSplitPoints(scratch);
+  for (const auto &crossing : crossings) {
+    getPointId(crossing.point); // store to nodes storage
+    edgeToSplitPoints[crossing.first].push_back(crossing.point);
+    edgeToSplitPoints[crossing.second].push_back(crossing.point);
   }
+  count(stats, &TriangulationStats::splitPoints, crossings.size());
 
   trace() << "Nodes:\n";
   for (size_t i = 0; i < nodes.size(); ++i) {
@@ -303,48 +888,93 @@ Ring normalizeRing(Ring ring) {
   }
 
   trace() << "Splitting edges:\n";
-  std::vector<Point> points;
+  std::pmr::vector<Point> points(scratch);
   for (const auto &[edge, splitPoints] : edgeToSplitPoints) {
+    auto [from, to] = *edges[edge];
     points.clear();
-    points.push_back(nodes[edges[edge]->first]);
-    points.push_back(nodes[edges[edge]->second]);
+    points.push_back(nodes[from]);
+    points.push_back(nodes[to]);
     for (auto p : splitPoints)
       points.push_back(p);
     std::sort(points.begin(), points.end());
+    bool reversed = nodes[to] < nodes[from]; // parts keep the ring direction
 
     edges[edge] = std::nullopt;
 
-    trace() << edges[edge]->first << '-' << edges[edge]->second << " to:\n";
+    trace() << from << '-' << to << " to:\n";
     for (auto b = points.begin(), e = std::next(points.begin()); e != points.end(); b++, e++) {
-      edges.emplace_back(std::make_pair(getPointId(*b), getPointId(*e)));
+      auto part = std::make_pair(getPointId(*b), getPointId(*e));
+      if (part.first == part.second) // welded split points
+        continue;
+      if (reversed)
+        std::swap(part.first, part.second);
+      edges.emplace_back(part);
       trace() << edges.back()->first << '-' << edges.back()->second << '\n';
     }
   }
+}
 
-  Point mostLeft = nodes[edges.front()->first]; // first node for dfs
-  std::vector<std::vector<std::pair<size_t, size_t>>> graph(nodes.size()); // planar(toId, edgeId)
-  for (size_t i = 0; i < edges.size(); ++i) {
-    auto e = edges[i];
+// ring - at least 2 points, the first one isn't repeated at the end.
+// Returns OK, CANCELLED or NUMERIC_FAILURE.
+Status split(const Ring &ring, const Options &options, SplitRing &result) {
+  auto scratch = result.edges.get_allocator().resource();
+  std::pmr::vector<Segment> segments(scratch);
+  prepareSplit(ring, options, result, segments);
+
+  // The crossings come in the pairs order whatever the threads, so the points are welded the same way
+  std::optional<PhaseTimer> timer;
+  timer.emplace(phase(options.stats, &TriangulationStats::intersectionTime));
+  auto threads = intersectionThreads(options, segments.size());
+  details::LockingResource sharedMemory(scratch);
+  auto crossings = findCrossings(segments, threads, options.cancel, threads > 1 ? &sharedMemory : scratch);
+  timer.reset();
+  if (crossings.status != Status::OK)
+    return crossings.status;
+  applyCrossings(crossings.value, options, result);
+  return Status::OK;
+}
+
+// The split ring graph traversed as one ring
+Ring traverse(const SplitRing &splitRing, const Options &options,
+              std::pmr::memory_resource *scratch, std::pmr::memory_resource *output) {
+  PhaseTimer timer(phase(options.stats, &TriangulationStats::traversalTime));
+  const auto &nodes = splitRing.welder.points();
+  const auto &edges = splitRing.edges;
+  auto getPointId = [&](Point p) {
+    return splitRing.welder.find(p);
+  };
+
+  auto firstEdge = std::find_if(edges.begin(), edges.end(), [](const auto &e) { return e.has_value(); });
+  Point mostLeft = nodes[(*firstEdge)->first]; // first node for dfs
+  for (const auto &e : edges) {
     if (!e)
       continue;
-    graph[e->first].emplace_back(e->second, i);
-    graph[e->second].emplace_back(e->first, i);
     mostLeft = std::min(mostLeft, nodes[e->first]);
     mostLeft = std::min(mostLeft, nodes[e->second]);
   }
+  PlanarGraph graph(nodes, edges, scratch);
 
   size_t startPointId = getPointId(mostLeft);
   trace() << "Start node: " << startPointId << '\n';
+
+  // Half edges of a node are ordered clockwise starting from the direction to
+  // the node dfs came from. The graph keeps a fixed clockwise order, so it's
+  // enough to remember where each node's order starts.
+  std::pmr::vector<size_t> rotation(nodes.size(), 0, scratch);
+  auto neighbour = [&](size_t nodeId, size_t i) -> const PlanarGraph::HalfEdge & {
+    auto halfEdges = graph.halfEdges(nodeId);
+    return halfEdges[(rotation[nodeId] + i) % halfEdges.size()];
+  };
+
   {   // setup traverse order
     auto fakeNode = mostLeft; // first node for dfs
     fakeNode.x = std::numeric_limits<double>::lowest(); // shift left
 
-    std::vector<double> angles(nodes.size());
-    std::vector<char> visited(nodes.size());
-    std::vector<std::pair<size_t/*node to*/, Point /*prev point*/>> stack{
-        {{startPointId, fakeNode}}};
+    std::pmr::vector<char> visited(nodes.size(), scratch);
+    std::pmr::vector<std::pair<size_t/*node to*/, Point /*prev point*/>> stack(scratch);
+    stack.emplace_back(startPointId, fakeNode);
 
-    std::vector<size_t> debugOrder;
+    std::pmr::vector<size_t> debugOrder(scratch);
     while (!stack.empty()) {
       auto [nodeId, prevPoint] = stack.back();
       auto nodePoint = nodes[nodeId];
@@ -354,59 +984,157 @@ Ring normalizeRing(Ring ring) {
       visited[nodeId] = true;
       debugOrder.push_back(nodeId);
 
-      auto &neighbours = graph[nodeId];
-      for (auto [toId, _] : neighbours) {
-        angles[toId] = angleRad(prevPoint, nodePoint, nodes[toId]);
-      }
-
-      std::sort(neighbours.begin(), neighbours.end(),
-                [&angles](auto l, auto r) {
-                  return angles[l.first] < angles[r.first];
-                });
-
-      for (auto [toId, _] : neighbours) {
-        stack.emplace_back(toId, nodePoint);
+      rotation[nodeId] = graph.clockwiseFrom(nodeId, {prevPoint.x - nodePoint.x, prevPoint.y - nodePoint.y});
+      for (size_t i = 0, degree = graph.halfEdges(nodeId).size(); i < degree; ++i) {
+        stack.emplace_back(neighbour(nodeId, i).to, nodePoint);
       }
     }
 
     trace() << "Debug order: " << debugOrder << '\n';
   }
 
-  std::vector<size_t> traverseOrder;
+  std::pmr::vector<size_t> traverseOrder(scratch);
   traverseOrder.reserve(nodes.size());
   { // traverse
-    std::vector<std::pair<size_t, size_t>> stack; // (nodeId, edgeId)
-    stack.push_back(graph[startPointId].back());
+    // Not yet taken half edges of a node are the first `remaining` ones
+    std::pmr::vector<size_t> remaining(nodes.size(), scratch);
+    for (size_t i = 0; i < nodes.size(); ++i)
+      remaining[i] = graph.halfEdges(i).size();
+    std::pmr::vector<char> usedEdges(edges.size(), 0, scratch);
+
+    std::pmr::vector<std::pair<size_t, size_t>> stack(scratch); // (nodeId, edgeId)
+    {
+      const auto &last = neighbour(startPointId, remaining[startPointId] - 1);
+      stack.emplace_back(last.to, last.edge);
+    }
     while (!stack.empty()) {
       auto [nodeId, edgeId] = stack.back();
       stack.pop_back();
-      if (!edges[edgeId]) {
+      if (usedEdges[edgeId]) {
         continue;
       }
-      edges[edgeId] = std::nullopt;
+      usedEdges[edgeId] = true;
       traverseOrder.push_back(nodeId);
-      auto &v = graph[nodeId];
-      while (!v.empty()) {
-        auto [toId, toEdgeId] = v.back();
-        v.pop_back();
-        if (!edges[toEdgeId])
+      auto &left = remaining[nodeId];
+      while (left != 0) {
+        const auto &next = neighbour(nodeId, --left);
+        if (usedEdges[next.edge])
           continue;
 
-        stack.emplace_back(toId, toEdgeId);
+        stack.emplace_back(next.to, next.edge);
         break;
       }
     }
   }
 
-  ring.clear();
+  Ring result(output);
   for (auto id : traverseOrder)
-    ring.push_back(nodes[id]);
+    result.push_back(nodes[id]);
 
   trace() << "Traverse order: " << traverseOrder << '\n';
 
-  return ring;
+  return result;
+}
+
+Ring normalize(Ring ring, const Options &options,
+               std::pmr::memory_resource *scratch, std::pmr::memory_resource *output, Status &status) {
+  if (ring.size() < 2)
+    return Ring(ring, output);
+
+  if (ring.back() == ring.front()) {
+    ring.pop_back();
+    if (ring.size() == 1)
+      return Ring(output);
+  }
+
+  SplitRing splitRing(options.snapTolerance, scratch);
+  status = split(ring, options, splitRing);
+  if (status != Status::OK)
+    return Ring(output);
+  return traverse(splitRing, options, scratch, output);
+}
+
+bool isInside(FillRule fillRule, long winding) {
+  switch (fillRule) {
+    case FillRule::EVEN_ODD:return winding % 2 != 0;
+    case FillRule::NON_ZERO:return winding != 0;
+  }
+  return false;
+}
+
+// The faces of the split ring graph chosen by the rule
+std::pmr::vector<Ring> faces(const SplitRing &splitRing, FillRule fillRule, const Options &options,
+                             std::pmr::memory_resource *scratch, std::pmr::memory_resource *output) {
+  std::pmr::vector<Ring> result(output);
+  PhaseTimer timer(phase(options.stats, &TriangulationStats::traversalTime));
+  const auto &nodes = splitRing.welder.points();
+  const auto &edges = splitRing.edges;
+  PlanarGraph graph(nodes, edges, scratch);
+  auto walk = graph.walkFaces(scratch);
+  if (walk.size() == 0)
+    return result;
+
+  // Winding numbers are spread from the outer face(the only one with a
+  // negative area, or the only face at all if the graph has no cycles).
+  // Crossing an edge from its right to its left adds one turn.
+  constexpr long UNKNOWN = std::numeric_limits<long>::min();
+  std::pmr::vector<long> winding(walk.size(), UNKNOWN, scratch);
+  std::pmr::vector<size_t> queue(scratch);
+  queue.reserve(walk.size());
+  auto outer = std::min_element(walk.doubleAreas.begin(), walk.doubleAreas.end()) - walk.doubleAreas.begin();
+  winding[outer] = 0;
+  queue.push_back(outer);
+  for (size_t q = 0; q < queue.size(); ++q) {
+    auto face = queue[q];
+    for (auto i = walk.offsets[face]; i < walk.offsets[face + 1]; ++i) {
+      auto h = walk.halfEdges[i];
+      const auto &halfEdge = graph.halfEdge(h);
+      auto other = walk.faceOf[halfEdge.twin];
+      if (winding[other] != UNKNOWN)
+        continue;
+
+      bool forward = edges[halfEdge.edge]->first == graph.from(h); // the face is on the edge left
+      winding[other] = winding[face] + (forward ? -1 : 1);
+      queue.push_back(other);
+    }
+  }
+
+  for (size_t face = 0; face < walk.size(); ++face) {
+    if (walk.doubleAreas[face] <= 0 || winding[face] == UNKNOWN || !isInside(fillRule, winding[face]))
+      continue;
+
+    // A face is walked counter clockwise, it's reversed if the ring goes around it clockwise
+    auto &faceRing = result.emplace_back();
+    for (auto i = walk.offsets[face]; i < walk.offsets[face + 1]; ++i) {
+      auto p = nodes[graph.from(walk.halfEdges[i])];
+      if (winding[face] > 0)
+        faceRing.push_back(p);
+      else
+        faceRing.push_front(p);
+    }
+  }
+
+  trace() << "Faces: " << result.size() << " of " << walk.size() << '\n';
+
+  return result;
 }
 
+std::pmr::vector<Ring> normalizeToFaces(Ring ring, FillRule fillRule, const Options &options,
+                                        std::pmr::memory_resource *scratch, std::pmr::memory_resource *output,
+                                        Status &status) {
+  if (ring.size() > 1 && ring.back() == ring.front())
+    ring.pop_back();
+  if (ring.size() < 3)
+    return std::pmr::vector<Ring>(output);
+
+  SplitRing splitRing(options.snapTolerance, scratch);
+  status = split(ring, options, splitRing);
+  if (status != Status::OK)
+    return std::pmr::vector<Ring>(output);
+  return faces(splitRing, fillRule, options, scratch, output);
+}
+} // namespace
+
 double angleRad(Point a, Point b, Point c) {
   a.x -= b.x;
   a.y -= b.y;
@@ -433,4 +1161,280 @@ bool Point::operator<(const Point &other) const {
   return tie() < other.tie();
 }
 
+struct Triangulator::State {
+  enum class Stage {
+    PREPARE, // the simplification, the nodes and edges
+    SEARCH,  // the self intersections
+    BUILD,   // the split graph traversal
+    CLIP,
+    DONE
+  };
+
+  State(Ring sourceRing, const Options &sourceOptions)
+      : options(sourceOptions),
+        countingMemory(memoryResource(options)),
+        scratch(options.stats ? &countingMemory : memoryResource(options)),
+        ring(std::move(sourceRing)),
+        segments(scratch),
+        faces(scratch),
+        triangles(memoryResource(options)) {
+    options.threads = 1;
+  }
+
+  // Does a part of the current stage
+  void advance(size_t &work) {
+    auto spend = [&work](size_t units) { work -= std::min(work, units); };
+    switch (stage) {
+      case Stage::PREPARE: {
+        if (!(options.snapTolerance >= 0))
+          return finish(Status::INVALID_OPTIONS);
+        trace() << "Triangulator: Source ring: " << ring << '\n';
+        spend(ring.size());
+        simplifyRing(ring, options, scratch);
+        if (ring.size() > 1 && ring.back() == ring.front())
+          ring.pop_back();
+        if (ring.size() < 3)
+          return finish(Status::OK);
+        // Made after the tolerance check, the welder raises for a negative one
+        splitRing.emplace(options.snapTolerance, scratch);
+        details::prepareSplit(ring, options, *splitRing, segments);
+        search.emplace(segments, scratch);
+        stage = Stage::SEARCH;
+        return;
+      }
+      case Stage::SEARCH: {
+        if (cancelled(options.cancel))
+          return finish(Status::CANCELLED);
+        PhaseTimer timer(phase(options.stats, &TriangulationStats::intersectionTime));
+        auto result = search->advance(work);
+        if (result != Status::OK)
+          return finish(result);
+        if (search->done())
+          stage = Stage::BUILD;
+        return;
+      }
+      case Stage::BUILD: {
+        spend(splitRing->edges.size());
+        details::applyCrossings(search->crossings(), options, *splitRing);
+        if (!options.fillRule)
+          faces.push_back(details::traverse(*splitRing, options, scratch, scratch));
+        else
+          faces = details::faces(*splitRing, *options.fillRule, options, scratch, scratch);
+        size_t vertices = 0;
+        for (const auto &face : faces)
+          vertices += face.size();
+        trace() << "Triangulator: " << faces.size() << " faces, " << vertices << " vertices\n";
+        if (vertices > 2 * faces.size())
+          triangles.reserve(vertices - 2 * faces.size());
+        stage = Stage::CLIP;
+        return;
+      }
+      case Stage::CLIP: {
+        if (face == faces.size())
+          return finish(status);
+        if (!clipper)
+          clipper.emplace(faces[face], options.stats, options.cancel, AppendTriangles{&triangles}, IgnoreLoops{});
+        if (auto result = clipper->advance(work)) {
+          clipper.reset();
+          ++face;
+          status = std::max(status, *result);
+          if (status == Status::CANCELLED)
+            return finish(status);
+        }
+        return;
+      }
+      case Stage::DONE:return;
+    }
+  }
+
+  void finish(Status result) {
+    stage = Stage::DONE;
+    status = result;
+    if (status == Status::OK && triangles.empty())
+      status = Status::DEGENERATE;
+    if (status > Status::NO_PROGRESS)
+      triangles.clear();
+
+    clipper.reset();
+    faces.clear();
+    search.reset();
+    if (options.stats) {
+      if (triangles.capacity() != 0)
+        countingMemory.account(triangles.capacity() * sizeof(Triangle));
+      countingMemory.report(*options.stats);
+    }
+  }
+
+  Options options;
+  details::CountingResource countingMemory;
+  std::pmr::memory_resource *scratch;
+  Ring ring;
+  std::optional<details::SplitRing> splitRing;
+  std::pmr::vector<details::Segment> segments;
+  std::optional<details::CrossingSearch> search;
+  std::pmr::vector<Ring> faces;
+  size_t face = 0; // being clipped
+  std::optional<TrianglesClipper> clipper;
+  Triangles triangles;
+  Status status = Status::OK;
+  Stage stage = Stage::PREPARE;
+};
+
+Triangulator::Triangulator(Ring ring, const Options &options)
+    : state(std::make_unique<State>(std::move(ring), options)) {}
+
+Triangulator::~Triangulator() = default;
+Triangulator::Triangulator(Triangulator &&) noexcept = default;
+Triangulator &Triangulator::operator=(Triangulator &&) noexcept = default;
+
+bool Triangulator::step(size_t work) {
+  while (!done() && work != 0)
+    state->advance(work);
+  return done();
+}
+
+bool Triangulator::step(std::chrono::nanoseconds time) {
+  auto deadline = std::chrono::steady_clock::now() + time;
+  while (!step(TIMED_STEP_WORK) && std::chrono::steady_clock::now() < deadline) {
+  }
+  return done();
+}
+
+bool Triangulator::done() const {
+  return state->stage == State::Stage::DONE;
+}
+
+Status Triangulator::status() const {
+  return state->status;
+}
+
+const Triangles &Triangulator::triangles() const {
+  return state->triangles;
+}
+
+namespace {
+
+// A ring node of the attributes output
+struct AttributeNode {
+  Point point;
+  uint32_t row;
+};
+
+const Point &point(const AttributeNode &node) { return node.point; }
+
+// The position of p on the segment a -> b, 0 - a, 1 - b
+double segmentPosition(Point a, Point b, Point p) {
+  auto dx = b.x - a.x, dy = b.y - a.y;
+  auto t = std::abs(dx) >= std::abs(dy) ? (p.x - a.x) / dx : (p.y - a.y) / dy;
+  return std::clamp(t, 0.0, 1.0);
+}
+
+} // namespace
+
+Result<std::pmr::vector<Mesh::Indices>> tryTriangulateAttributes(Ring ring, const Interpolate &interpolate,
+                                                                 const Options &options) noexcept {
+  auto stats = options.stats;
+  auto memory = memoryResource(options);
+  details::CountingResource countingMemory(memory);
+  auto scratch = stats ? &countingMemory : memory;
+  Result<std::pmr::vector<Mesh::Indices>> result{Status::OK, std::pmr::vector<Mesh::Indices>(memory)};
+  if (!(options.snapTolerance >= 0)) {
+    result.status = Status::INVALID_OPTIONS;
+    return result;
+  }
+
+  // The rows of the distinct points: of the first ring vertex at the point, or interpolated at a split point
+  details::PointWelder rowIds(0, scratch);
+  std::pmr::vector<uint32_t> rows(scratch);
+  std::optional<PhaseTimer> timer;
+  timer.emplace(phase(stats, &TriangulationStats::dedupTime));
+  rowIds.reserve(ring.size());
+  uint32_t vertex = 0;
+  for (const auto &p : ring) {
+    if (rowIds.weld(p) == rows.size())
+      rows.push_back(vertex);
+    vertex++;
+  }
+  timer.reset();
+
+  trace() << "triangulateAttributes: Source ring: " << ring << '\n';
+  simplifyRing(ring, options, scratch);
+  if (ring.size() > 1 && ring.back() == ring.front())
+    ring.pop_back();
+  std::pmr::vector<Ring> faces(scratch);
+  if (ring.size() > 2) {
+    details::SplitRing splitRing(options.snapTolerance, scratch);
+    std::pmr::vector<details::Segment> segments(scratch);
+    details::prepareSplit(ring, options, splitRing, segments);
+
+    timer.emplace(phase(stats, &TriangulationStats::intersectionTime));
+    auto threads = intersectionThreads(options, segments.size());
+    details::LockingResource sharedMemory(scratch);
+    auto crossings = details::findCrossings(segments, threads, options.cancel, threads > 1 ? &sharedMemory : scratch);
+    timer.reset();
+    result.status = crossings.status;
+    if (result.status == Status::OK) {
+      // the rows of the split points are a part of the edge splitting
+      timer.emplace(phase(stats, &TriangulationStats::traversalTime));
+      const auto &nodes = splitRing.welder.points();
+      for (const auto &crossing : crossings.value) {
+        const auto &p = crossing.point;
+        if (splitRing.welder.find(p) != details::PointWelder::NO_ID || rowIds.find(p) != details::PointWelder::NO_ID)
+          continue;
+        auto [from, to] = *splitRing.edges[crossing.first]; // in the ring direction
+        auto a = nodes[from], b = nodes[to];
+        rowIds.weld(p);
+        rows.push_back(interpolate(rows[rowIds.find(a)], rows[rowIds.find(b)], segmentPosition(a, b, p)));
+      }
+      timer.reset();
+      details::applyCrossings(crossings.value, options, splitRing);
+
+      if (!options.fillRule)
+        faces.push_back(details::traverse(splitRing, options, scratch, scratch));
+      else
+        faces = details::faces(splitRing, *options.fillRule, options, scratch, scratch);
+    }
+  }
+
+  auto &triangles = result.value;
+  size_t vertices = 0;
+  for (const auto &face : faces)
+    vertices += face.size();
+  if (vertices > 2 * faces.size())
+    triangles.reserve(vertices - 2 * faces.size());
+  std::pmr::list<AttributeNode> face(scratch);
+  for (const auto &faceRing : faces) {
+    if (result.status == Status::CANCELLED)
+      break;
+    face.clear();
+    for (const auto &p : faceRing)
+      face.push_back({p, rows[rowIds.find(p)]});
+    auto status = clipRing(
+        face, stats, options.cancel,
+        [&triangles](auto a, auto b, auto c, const Triangle &) { triangles.push_back({a->row, b->row, c->row}); },
+        [](auto, auto, auto) {});
+    result.status = std::max(result.status, status);
+  }
+
+  if (result.status == Status::OK && triangles.empty())
+    result.status = Status::DEGENERATE;
+  if (result.status > Status::NO_PROGRESS)
+    triangles.clear();
+
+  if (stats) {
+    if (triangles.capacity() != 0)
+      countingMemory.account(triangles.capacity() * sizeof(Mesh::Indices));
+    countingMemory.report(*stats);
+  }
+
+  return result;
+}
+
+std::pmr::vector<Mesh::Indices> triangulateAttributes(Ring ring, const Interpolate &interpolate,
+                                                      const Options &options) {
+  auto result = tryTriangulateAttributes(std::move(ring), interpolate, options);
+  details::raiseIfFailed(result.status);
+  return std::move(result.value);
+}
+
 }
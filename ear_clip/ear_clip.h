@@ -1,9 +1,20 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
 #include <vector>
 #include <list>
 #include <tuple>
+#include <utility>
 
 namespace ear_clip {
 
@@ -15,11 +26,181 @@ struct Point {
 };
 
 using Triangle = std::array<Point, 3>;
-using Ring = std::list<Point>;
+// Ring was std::list<Point> and triangulate() returned std::vector<Triangle>
+// before the memory resources came. The types(and the ABI) changed: code
+// which names Ring gets the pmr containers, code which passes its own
+// std::list<Point> still builds(see the triangulate() overload below).
+using Ring = std::pmr::list<Point>;
+using Triangles = std::pmr::vector<Triangle>;
+
+// Optional per-call profile of triangulate(). Nothing is measured unless a
+// stats object is passed in. Values are accumulated, so one object may be
+// reused to sum up several calls.
+struct TriangulationStats {
+  using Duration = std::chrono::nanoseconds;
+
+  // Wall time per phase
+  Duration dedupTime{};         // normalizeRing: point deduplication and edge building
+  Duration intersectionTime{};  // normalizeRing: self intersection search
+  Duration traversalTime{};     // normalizeRing: edge splitting and graph traversal
+  Duration simplifyTime{};      // triangulate: Options::simplifyTolerance pre-pass
+  Duration emptyLoopTime{};     // triangulate: zero area loops removal
+  Duration clipTime{};          // triangulate: ear clipping(without empty loops removal)
+
+  size_t pointInTriangleCalls = 0;
+  size_t rejectedEars = 0;      // ear candidates skipped by the clip loop
+  size_t counterResets = 0;     // clip loop progress counter resets
+  size_t splitPoints = 0;       // self intersection points found
+  size_t simplifiedPoints = 0;  // vertices removed by the simplification
+
+  // Memory taken from Options::memory, including the returned container
+  size_t allocations = 0;
+  size_t allocatedBytes = 0;    // total
+  size_t peakBytes = 0;         // the highest amount allocated at once(maximum over the calls)
+};
+
+// Which faces of a self intersecting ring are inside(by the ring winding number)
+enum class FillRule {
+  EVEN_ODD,
+  NON_ZERO
+};
+
+struct Options {
+  // Receives the call profile, nothing is measured if it's null
+  TriangulationStats *stats = nullptr;
+  // All the internal containers and the result are allocated from it.
+  // std::pmr::get_default_resource() is used if it's null.
+  std::pmr::memory_resource *memory = nullptr;
+  // Points which differ by no more than the tolerance in both coordinates are
+  // welded into one. It prevents near duplicate self intersection points from
+  // fragmenting the ring. 0 - only equal points are welded.
+  double snapTolerance = 0;
+  // If it's set, the self intersections resolution splits the ring into
+  // simple faces chosen by the rule, which are triangulated independently.
+  // Otherwise the whole planar graph is traversed as one ring.
+  std::optional<FillRule> fillRule;
+  // Threads to search the self intersections and to triangulate the faces
+  // with, 0 - up to the hardware concurrency if the ring is large enough
+  size_t threads = 0;
+  // If it's set, the call is abandoned with Cancelled soon after the flag
+  // is raised(by another thread)
+  const std::atomic<bool> *cancel = nullptr;
+  // If it's set, the ring is simplified before the normalization: the
+  // vertices closer than the tolerance to the segment of their neighbours are
+  // removed, 0 - only the collinear ones(see simplify())
+  std::optional<double> simplifyTolerance;
+};
+
+struct Cancelled : std::runtime_error {
+  Cancelled() : std::runtime_error("Triangulation is cancelled") {}
+};
+
+// The outcome of the noexcept API, in the order of severity
+enum class Status {
+  OK,
+  DEGENERATE,      // the ring has no area, there are no triangles
+  NO_PROGRESS,     // no ear was found while some area was left, the triangles are partial
+  CANCELLED,       // Options::cancel was raised(Cancelled)
+  NUMERIC_FAILURE, // crossing edges have no intersection point, e.g. the coordinates overflow(std::logic_error)
+  INVALID_OPTIONS  // e.g. a negative or NaN Options::snapTolerance(std::invalid_argument)
+};
+
+const char *describe(Status status) noexcept;
+
+// value is what the throwing function returns for OK, DEGENERATE and
+// NO_PROGRESS. It's empty for the rest, as the throwing function throws.
+template <class T>
+struct Result {
+  Status status = Status::OK;
+  T value;
+};
 
 void enableTrace(bool enable);
 
-std::vector<Triangle> triangulate(Ring ring);
+Triangles triangulate(Ring ring, const Options &options = {});
+
+// The std containers entry point of the earlier versions. The ring is copied
+// in and the triangles out, the pmr one above saves that.
+template <class Allocator>
+std::vector<Triangle> triangulate(const std::list<Point, Allocator> &ring, const Options &options = {}) {
+  auto triangles = triangulate(Ring(ring.begin(), ring.end()), options);
+  return {triangles.begin(), triangles.end()};
+}
+
+// Indexed triangulation with the triangle adjacency(a half-edge mesh)
+struct Mesh {
+  using Indices = std::array<uint32_t, 3>;
+  using Flags = std::array<bool, 3>;
+  static constexpr uint32_t NO_NEIGHBOUR = UINT32_MAX;
+
+  std::pmr::vector<Point> vertices;   // distinct points of the normalized ring
+  std::pmr::vector<Indices> triangles; // the same triangles in the same order as triangulate() gives
+  // neighbours[t][i] - the triangle across the edge triangles[t][i] - triangles[t][(i + 1) % 3],
+  // NO_NEIGHBOUR on the boundary
+  std::pmr::vector<Indices> neighbours;
+  // constrained[t][i] - the edge i is on the ring(not a diagonal made by the clipping)
+  std::pmr::vector<Flags> constrained;
+};
+
+// Like triangulate(), but the neighbours are recorded by the clip loop as
+// the ears are cut off the diagonals, there is no edge hashing pass. Only the
+// edges left on the ring(shared by the faces or traversed twice by the ring)
+// are matched afterwards. The faces are clipped in one thread.
+Mesh triangulateMesh(Ring ring, const Options &options = {});
+
+// The noexcept variants, triangulate() and triangulateMesh() are their thin
+// wrappers. Nothing is thrown or caught on the way, so the failures cost no
+// unwinding and the library builds with -fno-exceptions(the throwing
+// functions abort there). An allocation failure still terminates.
+Result<Triangles> tryTriangulate(Ring ring, const Options &options = {}) noexcept;
+Result<Mesh> tryTriangulateMesh(Ring ring, const Options &options = {}) noexcept;
+
+// Makes the attribute row of the point of the ring edge from -> to at t(0 -
+// from, 1 - to) out of the rows of the edge ends, returns its index. It
+// mustn't throw.
+using Interpolate = std::function<uint32_t(uint32_t from, uint32_t to, double t)>;
+
+// Like triangulate(), but the triangle vertices are attribute rows: the ring
+// vertex i has the row i. A self intersection point gets its row from
+// interpolate(), along the first(in the ring order) of the crossing edges.
+// The welded vertices(equal or within snapTolerance) have the row of the
+// first of them. A point welded afterwards may leave its row unused.
+Result<std::pmr::vector<Mesh::Indices>> tryTriangulateAttributes(Ring ring, const Interpolate &interpolate,
+                                                                 const Options &options = {}) noexcept;
+std::pmr::vector<Mesh::Indices> triangulateAttributes(Ring ring, const Interpolate &interpolate,
+                                                      const Options &options = {});
+
+// triangulate() in steps of bounded work, for the callers which can't block
+// for the whole of it, e.g. a render loop which has a millisecond per frame.
+// The triangles are appended to triangles() as they are clipped, it's the
+// triangulate() result once done(). It all runs in the calling thread,
+// options.threads isn't used.
+class Triangulator {
+ public:
+  explicit Triangulator(Ring ring, const Options &options = {});
+  ~Triangulator();
+  Triangulator(Triangulator &&) noexcept;
+  Triangulator &operator=(Triangulator &&) noexcept;
+
+  // Does about `work` units: a segment pair tested for a crossing, an ear
+  // candidate or a point tested against it. The parts which aren't split
+  // are finished even if they overrun: the ring preparation and the split
+  // graph traversal, O(n log n), a crossings loop row or an ear test, O(n).
+  // Returns done().
+  bool step(size_t work);
+  // Steps until done() or the time is out
+  bool step(std::chrono::nanoseconds time);
+
+  [[nodiscard]] bool done() const;
+  // The tryTriangulate() status once done, OK until then
+  [[nodiscard]] Status status() const;
+  [[nodiscard]] const Triangles &triangles() const;
+
+ private:
+  struct State;
+
+  std::unique_ptr<State> state;
+};
 
 namespace details {
 
@@ -31,13 +212,36 @@ enum class VertexOrder {
 
 VertexOrder vertexOrder(const Ring &ring);
 VertexOrder vertexOrder(const Triangle &triangle);
-Ring normalizeRing(Ring ring);
+Ring normalizeRing(Ring ring, const Options &options = {});
+// Splits the ring into the faces of the given fill rule. The faces have the
+// direction the ring winds around them.
+std::pmr::vector<Ring> normalizeFaces(Ring ring, FillRule fillRule, const Options &options = {});
 
 bool intersects(Point a, Point b, Point c, Point d);
+// Throws std::logic_error for the parallel lines
 Point intersection(Point a, Point b, Point c, Point d);
+// std::nullopt for the parallel lines
+std::optional<Point> tryIntersection(Point a, Point b, Point c, Point d) noexcept;
 double angleRad(Point a, Point b, Point c);
 bool pointInTriangle(const Triangle &t, Point p);
 
+// Adds the counters and the times of the other call(of another thread), the peak is the larger one
+void merge(TriangulationStats &to, const TriangulationStats &from);
+
+// Throws the exception of the throwing API for a failure status(see Status)
+void raiseIfFailed(Status status);
+
+// Throws the exception, aborts in the -fno-exceptions builds
+template <class E, class... Args>
+[[noreturn]] void raise(Args &&...args) {
+#if defined(__cpp_exceptions)
+  throw E(std::forward<Args>(args)...);
+#else
+  ((void)args, ...);
+  std::abort();
+#endif
+}
+
 } // namespace details
 
 } // namespace ear_clip
\ No newline at end of file
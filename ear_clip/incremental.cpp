@@ -0,0 +1,541 @@
+#include "incremental.h"
+#include "point_welder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <utility>
+
+namespace ear_clip {
+
+namespace {
+
+double cross(Point a, Point b, Point c) {
+  return (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+}
+
+bool onSegment(Point a, Point b, Point p) {
+  return cross(a, b, p) == 0 &&
+      std::min(a.x, b.x) <= p.x && p.x <= std::max(a.x, b.x) &&
+      std::min(a.y, b.y) <= p.y && p.y <= std::max(a.y, b.y);
+}
+
+// Segments have a common point. Segments with a common end point meet only if
+// they overlap.
+bool meet(Point a, Point b, Point c, Point d) {
+  if (a == c || a == d || b == c || b == d) {
+    auto [shared, p, q] = a == c ? std::tuple{a, b, d} : a == d ? std::tuple{a, b, c}
+        : b == c ? std::tuple{b, a, d} : std::tuple{b, a, c};
+    return cross(shared, p, q) == 0 &&
+        (p.x - shared.x) * (q.x - shared.x) + (p.y - shared.y) * (q.y - shared.y) > 0;
+  }
+
+  auto abc = cross(a, b, c), abd = cross(a, b, d);
+  auto cda = cross(c, d, a), cdb = cross(c, d, b);
+  if (((abc > 0 && abd < 0) || (abc < 0 && abd > 0)) && ((cda > 0 && cdb < 0) || (cda < 0 && cdb > 0)))
+    return true;
+
+  return onSegment(a, b, c) || onSegment(a, b, d) || onSegment(c, d, a) || onSegment(c, d, b);
+}
+
+enum class Location {
+  OUTSIDE,
+  BOUNDARY,
+  INSIDE
+};
+
+// Even-odd rule, so the polygon may be self intersecting
+Location locate(const std::pmr::vector<Point> &polygon, Point p) {
+  bool inside = false;
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+    auto a = polygon[j], b = polygon[i];
+    if (onSegment(a, b, p))
+      return Location::BOUNDARY;
+    if ((a.y > p.y) != (b.y > p.y) && (p.x - a.x) < (b.x - a.x) * (p.y - a.y) / (b.y - a.y))
+      inside = !inside;
+  }
+
+  return inside ? Location::INSIDE : Location::OUTSIDE;
+}
+
+double doubleArea(const std::pmr::vector<Point> &polygon) {
+  double result = 0;
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+    result += polygon[j].x * polygon[i].y - polygon[i].x * polygon[j].y;
+  return result;
+}
+
+double doubleArea(const Triangle &t) {
+  return cross(t[0], t[1], t[2]);
+}
+
+// Times the patch may grow before giving up
+constexpr size_t MAX_PATCH_GROWTH = 2;
+
+bool sameArea(double a, double b) {
+  return std::abs(a - b) <= std::max(std::abs(a), std::abs(b)) * 1e-9;
+}
+
+// The count of cells along a side, clamped before the cast: the ratio may be huge or NaN
+size_t gridSize(double cells, size_t max) {
+  return cells >= 1 ? static_cast<size_t>(std::min(cells, static_cast<double>(max))) : 1;
+}
+
+} // namespace
+
+IncrementalTriangulation::IncrementalTriangulation(const Ring &ring, const Options &options)
+    : options(options), memory(options.memory ? options.memory : std::pmr::get_default_resource()),
+      vertices(memory), freeVertices(memory), triangles_(memory), freeTriangles(memory), edgeCells(memory) {
+  VertexId last = NO_VERTEX;
+  for (const auto &p : ring) {
+    auto vertex = newVertex(p);
+    if (last == NO_VERTEX) {
+      first_ = vertex;
+      vertices[vertex].prev = vertices[vertex].next = vertex;
+    } else {
+      vertices[vertex].prev = last;
+      vertices[vertex].next = first_;
+      vertices[last].next = vertex;
+      vertices[first_].prev = vertex;
+    }
+    vertices[vertex].inRing = true;
+    last = vertex;
+    ++size_;
+  }
+
+  rebuild();
+}
+
+IncrementalTriangulation::VertexId IncrementalTriangulation::insert(VertexId after, Point p) {
+  auto vertex = newVertex(p);
+  vertices[vertex].inRing = true;
+  ++size_;
+  if (after == NO_VERTEX) {
+    first_ = vertex;
+    vertices[vertex].prev = vertices[vertex].next = vertex;
+    rebuild();
+    return vertex;
+  }
+
+  auto before = vertices[after].next;
+  removeEdge(after);
+  vertices[vertex].prev = after;
+  vertices[vertex].next = before;
+  vertices[after].next = vertex;
+  vertices[before].prev = vertex;
+  addEdge(after);
+  addEdge(vertex);
+
+  if (!simple || !update({{after, before}, memory}, {{after, vertex, before}, memory}))
+    rebuild();
+  return vertex;
+}
+
+void IncrementalTriangulation::move(VertexId vertex, Point p) {
+  auto old = vertices[vertex].point;
+  if (old == p)
+    return;
+
+  std::pmr::vector<VertexId> chain({vertices[vertex].prev, vertex, vertices[vertex].next}, memory);
+  removeEdge(chain[0]);
+  removeEdge(vertex);
+  vertices[vertex].point = p;
+  addEdge(chain[0]);
+  addEdge(vertex);
+  if (!simple || !update(chain, chain, old))
+    rebuild();
+}
+
+void IncrementalTriangulation::remove(VertexId vertex) {
+  auto prev = vertices[vertex].prev, next = vertices[vertex].next;
+  removeEdge(vertex);
+  --size_;
+  if (size_ == 0) {
+    first_ = NO_VERTEX;
+  } else {
+    removeEdge(prev);
+    vertices[prev].next = next;
+    vertices[next].prev = prev;
+    addEdge(prev);
+    if (first_ == vertex)
+      first_ = next;
+  }
+  vertices[vertex].inRing = false;
+
+  if (!simple || size_ < 3 || !update({{prev, vertex, next}, memory}, {{prev, next}, memory}))
+    rebuild();
+  freeVertex(vertex);
+}
+
+Ring IncrementalTriangulation::ring() const {
+  Ring result(memory);
+  for (size_t i = 0, vertex = first_; i < size_; ++i, vertex = vertices[vertex].next)
+    result.push_back(vertices[vertex].point);
+  return result;
+}
+
+std::vector<IncrementalTriangulation::Indices> IncrementalTriangulation::indices() const {
+  std::vector<Indices> result;
+  result.reserve(trianglesCount());
+  for (const auto &t : triangles_) {
+    if (t[0] != NO_VERTEX)
+      result.push_back(t);
+  }
+  return result;
+}
+
+Triangles IncrementalTriangulation::triangles() const {
+  Triangles result(memory);
+  result.reserve(trianglesCount());
+  for (const auto &t : triangles_) {
+    if (t[0] != NO_VERTEX)
+      result.push_back({vertices[t[0]].point, vertices[t[1]].point, vertices[t[2]].point});
+  }
+  return result;
+}
+
+IncrementalTriangulation::VertexId IncrementalTriangulation::newVertex(Point p) {
+  VertexId vertex;
+  if (freeVertices.empty()) {
+    vertex = vertices.size();
+    vertices.emplace_back(memory);
+  } else {
+    vertex = freeVertices.back();
+    freeVertices.pop_back();
+  }
+
+  vertices[vertex].point = p;
+  return vertex;
+}
+
+void IncrementalTriangulation::freeVertex(VertexId vertex) {
+  // field by field: the incident triangles keep their memory
+  auto &v = vertices[vertex];
+  v.point = {};
+  v.prev = v.next = NO_VERTEX;
+  v.inRing = v.intersection = false;
+  v.triangles.clear();
+  freeVertices.push_back(vertex);
+}
+
+void IncrementalTriangulation::addTriangle(const Indices &t) {
+  size_t triangle;
+  if (freeTriangles.empty()) {
+    triangle = triangles_.size();
+    triangles_.push_back(t);
+  } else {
+    triangle = freeTriangles.back();
+    freeTriangles.pop_back();
+    triangles_[triangle] = t;
+  }
+
+  for (auto vertex : t)
+    vertices[vertex].triangles.push_back(triangle);
+}
+
+void IncrementalTriangulation::removeTriangle(size_t triangle) {
+  for (auto vertex : triangles_[triangle]) {
+    auto &incident = vertices[vertex].triangles;
+    *std::find(incident.begin(), incident.end(), triangle) = incident.back();
+    incident.pop_back();
+  }
+
+  triangles_[triangle] = {NO_VERTEX, NO_VERTEX, NO_VERTEX};
+  freeTriangles.push_back(triangle);
+}
+
+void IncrementalTriangulation::clear() {
+  for (VertexId vertex = 0; vertex < vertices.size(); ++vertex) {
+    vertices[vertex].triangles.clear();
+    if (vertices[vertex].intersection)
+      freeVertex(vertex);
+  }
+
+  triangles_.clear();
+  freeTriangles.clear();
+}
+
+bool IncrementalTriangulation::update(const std::pmr::vector<VertexId> &oldChain,
+                                      const std::pmr::vector<VertexId> &newChain, std::optional<Point> movedFrom) {
+  // The patch: triangles of the fans of the old chain vertices. If the edit
+  // doesn't fit, it grows by the fans of its vertices.
+  std::pmr::vector<VertexId> seeds(oldChain.begin(), oldChain.end(), memory);
+  std::pmr::vector<size_t> patch(memory);
+  std::pmr::vector<VertexId> loop(memory), newLoop(memory);
+  std::pmr::vector<Point> oldPolygon(memory), newPolygon(memory);
+  auto oldPoint = [&](VertexId vertex) {
+    return movedFrom && vertex == oldChain[1] ? *movedFrom : vertices[vertex].point;
+  };
+  auto buildPatch = [&]() {
+    patch.clear();
+    for (auto vertex : seeds)
+      patch.insert(patch.end(), vertices[vertex].triangles.begin(), vertices[vertex].triangles.end());
+    std::sort(patch.begin(), patch.end());
+    patch.erase(std::unique(patch.begin(), patch.end()), patch.end());
+
+    // The patch boundary: its edges without twins
+    std::pmr::vector<std::pair<VertexId, VertexId>> edges(memory);
+    for (auto triangle : patch) {
+      const auto &t = triangles_[triangle];
+      for (size_t i = 0; i < 3; ++i)
+        edges.emplace_back(t[i], t[(i + 1) % 3]);
+    }
+    std::sort(edges.begin(), edges.end());
+    std::pmr::vector<std::pair<VertexId, VertexId>> boundary(memory);
+    for (const auto &[from, to] : edges) {
+      if (!std::binary_search(edges.begin(), edges.end(), std::pair{to, from}))
+        boundary.emplace_back(from, to);
+    }
+
+    // Walk it from the chain start. A vertex with two outgoing boundary edges
+    // or several boundary loops - the patch isn't a disk.
+    loop.clear();
+    for (auto vertex = oldChain.front(); loop.size() <= boundary.size();) {
+      auto it = std::lower_bound(boundary.begin(), boundary.end(), std::pair{vertex, VertexId{0}});
+      if (it == boundary.end() || it->first != vertex || (it + 1 != boundary.end() && (it + 1)->first == vertex))
+        return false;
+      loop.push_back(vertex);
+      vertex = it->second;
+      if (vertex == oldChain.front())
+        break;
+    }
+    if (loop.size() != boundary.size() || !std::equal(oldChain.begin(), oldChain.end(), loop.begin()))
+      return false;
+
+    // Old and new patch polygons
+    oldPolygon.clear();
+    for (auto vertex : loop)
+      oldPolygon.push_back(oldPoint(vertex));
+    newLoop.assign(newChain.begin(), newChain.end() - 1);
+    newLoop.insert(newLoop.end(), loop.begin() + oldChain.size() - 1, loop.end());
+    newPolygon.clear();
+    for (auto vertex : newLoop)
+      newPolygon.push_back(vertices[vertex].point);
+
+    // The new patch must be simple
+    auto n = newPolygon.size();
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = i + 1; j < n; ++j) {
+        if (meet(newPolygon[i], newPolygon[(i + 1) % n], newPolygon[j], newPolygon[(j + 1) % n]))
+          return false;
+      }
+    }
+    return true;
+  };
+
+  for (size_t growth = 0; !buildPatch(); ++growth) {
+    if (growth == MAX_PATCH_GROWTH)
+      return false;
+    seeds.clear();
+    for (auto triangle : patch)
+      seeds.insert(seeds.end(), triangles_[triangle].begin(), triangles_[triangle].end());
+  }
+  auto n = newPolygon.size();
+
+  // If the new chain is inside the old patch, the rest of the triangles aren't touched
+  auto chainInside = true;
+  for (size_t i = 0; i + 1 < newChain.size() && chainInside; ++i) {
+    auto a = vertices[newChain[i]].point, b = vertices[newChain[i + 1]].point;
+    chainInside = locate(oldPolygon, {(a.x + b.x) / 2, (a.y + b.y) / 2}) == Location::INSIDE &&
+        (i == 0 || locate(oldPolygon, a) == Location::INSIDE);
+    for (size_t j = 0; j + 1 < oldChain.size() && chainInside; ++j)
+      chainInside = !meet(a, b, oldPolygon[j], oldPolygon[j + 1]);
+  }
+  if (!chainInside && reachesOtherVertices(oldPolygon, oldChain.size(), newChain))
+    return false;
+
+  // Re-triangulate the patch, all its vertices must be kept
+  Ring ring(newPolygon.begin(), newPolygon.end(), memory);
+  auto triangles = triangulate(std::move(ring), options);
+
+  details::PointWelder welder(0, memory);
+  welder.reserve(n);
+  for (const auto &p : newPolygon)
+    welder.weld(p);
+  if (welder.size() != n)
+    return false;
+
+  std::pmr::vector<Indices> result(memory);
+  result.reserve(triangles.size());
+  double area = 0;
+  for (const auto &t : triangles) {
+    Indices indices{};
+    for (size_t i = 0; i < 3; ++i) {
+      auto id = welder.find(t[i]);
+      if (id == details::PointWelder::NO_ID)
+        return false;
+      indices[i] = newLoop[id];
+    }
+    area += doubleArea(t);
+    result.push_back(indices);
+  }
+  if (!sameArea(area, doubleArea(newPolygon)))
+    return false;
+
+  for (auto triangle : patch)
+    removeTriangle(triangle);
+  for (const auto &t : result)
+    addTriangle(t);
+  ++localUpdates_;
+  return true;
+}
+
+bool IncrementalTriangulation::reachesOtherVertices(const std::pmr::vector<Point> &oldPolygon, size_t oldChainSize,
+                                                    const std::pmr::vector<VertexId> &newChain) const {
+  // The region between the old and the new chains
+  std::pmr::vector<Point> changed(oldPolygon.begin(), oldPolygon.begin() + oldChainSize, memory);
+  for (auto it = newChain.rbegin() + 1; it + 1 != newChain.rend(); ++it)
+    changed.push_back(vertices[*it].point);
+
+  auto isNewEdge = [&](VertexId a, VertexId b) {
+    for (size_t i = 0; i + 1 < newChain.size(); ++i) {
+      if (newChain[i] == a && newChain[i + 1] == b)
+        return true;
+    }
+    return false;
+  };
+
+  // Only the edges over the region bbox may meet the new chain or start in the region
+  Point min = changed.front(), max = changed.front();
+  for (const auto &p : changed) {
+    min = {std::min(min.x, p.x), std::min(min.y, p.y)};
+    max = {std::max(max.x, p.x), std::max(max.y, p.y)};
+  }
+  return anyEdge(min, max, [&](VertexId vertex) {
+    auto next = vertices[vertex].next;
+    if (isNewEdge(vertex, next))
+      return false;
+
+    auto a = vertices[vertex].point, b = vertices[next].point;
+    for (size_t j = 0; j + 1 < newChain.size(); ++j) {
+      if (meet(a, b, vertices[newChain[j]].point, vertices[newChain[j + 1]].point))
+        return true;
+    }
+
+    return std::find(newChain.begin(), newChain.end(), vertex) == newChain.end() &&
+        locate(changed, a) != Location::OUTSIDE;
+  });
+}
+
+void IncrementalTriangulation::rebuild() {
+  clear();
+  ++rebuilds_;
+  simple = false;
+  buildEdgeGrid();
+  if (size_ < 3)
+    return;
+
+  details::PointWelder welder(0, memory);
+  welder.reserve(size_);
+  std::pmr::vector<VertexId> ids(memory); // welder id -> vertex
+  std::pmr::vector<Point> polygon(memory);
+  for (size_t i = 0, vertex = first_; i < size_; ++i, vertex = vertices[vertex].next) {
+    polygon.push_back(vertices[vertex].point);
+    if (welder.weld(vertices[vertex].point) == ids.size())
+      ids.push_back(vertex);
+  }
+
+  auto triangles = triangulate(ring(), options);
+  double area = 0;
+  for (const auto &t : triangles) {
+    Indices indices{};
+    for (size_t i = 0; i < 3; ++i) {
+      auto id = welder.weld(t[i]);
+      if (id == ids.size()) {
+        auto vertex = newVertex(t[i]);
+        vertices[vertex].intersection = true;
+        ids.push_back(vertex);
+      }
+      indices[i] = ids[id];
+    }
+    area += doubleArea(t);
+    addTriangle(indices);
+  }
+
+  simple = ids.size() == size_ && sameArea(area, doubleArea(polygon));
+}
+
+void IncrementalTriangulation::buildEdgeGrid() {
+  edgeCells.clear();
+  columns = rows = 0;
+  if (size_ == 0)
+    return;
+
+  // About one cell per vertex over the ring bbox
+  auto p = vertices[first_].point;
+  gridLeft = p.x, gridBottom = p.y;
+  double right = p.x, top = p.y;
+  for (size_t i = 0, vertex = first_; i < size_; ++i, vertex = vertices[vertex].next) {
+    p = vertices[vertex].point;
+    gridLeft = std::min(gridLeft, p.x);
+    right = std::max(right, p.x);
+    gridBottom = std::min(gridBottom, p.y);
+    top = std::max(top, p.y);
+  }
+  auto width = std::max(right - gridLeft, std::numeric_limits<double>::min());
+  auto height = std::max(top - gridBottom, std::numeric_limits<double>::min());
+  auto side = std::sqrt(width * height / static_cast<double>(size_));
+  columns = gridSize(width / side, size_);
+  rows = gridSize(height / side, size_);
+  cellWidth = width / static_cast<double>(columns);
+  cellHeight = height / static_cast<double>(rows);
+
+  edgeCells.resize(columns * rows); // the cells take the memory of the grid
+  for (size_t i = 0, vertex = first_; i < size_; ++i, vertex = vertices[vertex].next)
+    addEdge(vertex);
+}
+
+size_t IncrementalTriangulation::column(double x) const {
+  auto c = (x - gridLeft) / cellWidth;
+  return c >= 0 ? static_cast<size_t>(std::min(c, static_cast<double>(columns - 1))) : 0;
+}
+
+size_t IncrementalTriangulation::row(double y) const {
+  auto r = (y - gridBottom) / cellHeight;
+  return r >= 0 ? static_cast<size_t>(std::min(r, static_cast<double>(rows - 1))) : 0;
+}
+
+template <class F>
+bool IncrementalTriangulation::anyEdge(Point min, Point max, F &&f) const {
+  if (edgeCells.empty())
+    return false;
+  for (auto r = row(min.y), r1 = row(max.y); r <= r1; ++r) {
+    for (auto c = column(min.x), c1 = column(max.x); c <= c1; ++c) {
+      for (auto from : edgeCells[r * columns + c]) {
+        if (f(from))
+          return true;
+      }
+    }
+  }
+  return false;
+}
+
+// The edge is in the cells of its bbox
+void IncrementalTriangulation::addEdge(VertexId from) {
+  if (edgeCells.empty())
+    return;
+  auto a = vertices[from].point, b = vertices[vertices[from].next].point;
+  for (auto r = row(std::min(a.y, b.y)), r1 = row(std::max(a.y, b.y)); r <= r1; ++r) {
+    for (auto c = column(std::min(a.x, b.x)), c1 = column(std::max(a.x, b.x)); c <= c1; ++c)
+      edgeCells[r * columns + c].push_back(from);
+  }
+}
+
+void IncrementalTriangulation::removeEdge(VertexId from) {
+  if (edgeCells.empty())
+    return;
+  auto a = vertices[from].point, b = vertices[vertices[from].next].point;
+  for (auto r = row(std::min(a.y, b.y)), r1 = row(std::max(a.y, b.y)); r <= r1; ++r) {
+    for (auto c = column(std::min(a.x, b.x)), c1 = column(std::max(a.x, b.x)); c <= c1; ++c) {
+      auto &cell = edgeCells[r * columns + c];
+      auto it = std::find(cell.begin(), cell.end(), from);
+      if (it != cell.end()) {
+        *it = cell.back();
+        cell.pop_back();
+      }
+    }
+  }
+}
+
+} // namespace ear_clip
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "ear_clip.h"
+
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+namespace ear_clip {
+
+// A triangulation which follows edits of its ring. An edit re-triangulates
+// only the patch of triangles around the changed vertices(the fans of the
+// changed edge ends), so it costs O(patch) instead of a full triangulate().
+// The whole ring is triangulated again only if the patch can't take the
+// edit: the ring becomes self intersecting, the edit reaches outside of the
+// patch over other vertices, or the ring isn't simple already.
+//
+// The check for the other ring vertices reached by an edit visits only the
+// ring edges near the patch: the edges are bucketed into a grid of about one
+// cell per vertex, made by the full triangulation. The containers are
+// allocated from Options::memory.
+//
+// Vertices are addressed by ids which stay valid until the vertex is
+// removed. Ids of removed vertices are reused.
+class IncrementalTriangulation {
+ public:
+  using VertexId = size_t;
+  using Indices = std::array<VertexId, 3>;
+  static constexpr VertexId NO_VERTEX = SIZE_MAX;
+
+  explicit IncrementalTriangulation(const Ring &ring = {}, const Options &options = {});
+
+  // Inserts the point after the vertex(NO_VERTEX - into an empty ring), returns its id
+  VertexId insert(VertexId after, Point p);
+  void move(VertexId vertex, Point p);
+  void remove(VertexId vertex);
+
+  [[nodiscard]] size_t size() const { return size_; }
+  [[nodiscard]] VertexId first() const { return first_; }
+  [[nodiscard]] VertexId next(VertexId vertex) const { return vertices[vertex].next; }
+  [[nodiscard]] VertexId prev(VertexId vertex) const { return vertices[vertex].prev; }
+  [[nodiscard]] Point point(VertexId vertex) const { return vertices[vertex].point; }
+  [[nodiscard]] Ring ring() const;
+
+  [[nodiscard]] size_t trianglesCount() const { return triangles_.size() - freeTriangles.size(); }
+  // Vertex ids of the triangles. Self intersection points of a non simple
+  // ring have ids too, they aren't in the ring.
+  [[nodiscard]] std::vector<Indices> indices() const;
+  [[nodiscard]] Triangles triangles() const;
+
+  // How the edits were applied
+  [[nodiscard]] size_t localUpdates() const { return localUpdates_; }
+  [[nodiscard]] size_t rebuilds() const { return rebuilds_; }
+
+ private:
+  struct Vertex {
+    explicit Vertex(std::pmr::memory_resource *memory) : triangles(memory) {}
+
+    Point point{};
+    VertexId prev = NO_VERTEX, next = NO_VERTEX;
+    bool inRing = false;
+    bool intersection = false; // a self intersection point of a non simple ring
+    std::pmr::vector<size_t> triangles; // incident triangles
+  };
+
+  VertexId newVertex(Point p);
+  void freeVertex(VertexId vertex);
+  void addTriangle(const Indices &t);
+  void removeTriangle(size_t triangle);
+  void clear();
+
+  // The old chain of vertices in the ring has been replaced by the new one,
+  // both have the same ends. movedFrom - the old point of the middle vertex
+  // if it's moved. Returns false if the patch can't take it.
+  bool update(const std::pmr::vector<VertexId> &oldChain, const std::pmr::vector<VertexId> &newChain,
+              std::optional<Point> movedFrom = std::nullopt);
+  // The new chain crosses the ring or the area between the chains has other
+  // ring vertices
+  [[nodiscard]] bool reachesOtherVertices(const std::pmr::vector<Point> &oldPolygon, size_t oldChainSize,
+                                          const std::pmr::vector<VertexId> &newChain) const;
+  void rebuild();
+
+  // The grid of the ring edges(an edge is keyed by its first vertex), the
+  // points out of the grid bounds are in the border cells
+  void buildEdgeGrid();
+  void addEdge(VertexId from);
+  void removeEdge(VertexId from);
+  [[nodiscard]] size_t column(double x) const;
+  [[nodiscard]] size_t row(double y) const;
+  // Calls f(from) for the edges of the cells overlapping the rect(an edge
+  // may come several times) until it returns true
+  template <class F>
+  bool anyEdge(Point min, Point max, F &&f) const;
+
+  Options options;
+  std::pmr::memory_resource *memory;
+  std::pmr::vector<Vertex> vertices;
+  std::pmr::vector<VertexId> freeVertices;
+  std::pmr::vector<Indices> triangles_; // removed ones are {NO_VERTEX, ...}
+  std::pmr::vector<size_t> freeTriangles;
+  double gridLeft = 0, gridBottom = 0;
+  double cellWidth = 1, cellHeight = 1;
+  size_t columns = 0, rows = 0;
+  std::pmr::vector<std::pmr::vector<VertexId>> edgeCells;
+  VertexId first_ = NO_VERTEX;
+  size_t size_ = 0;
+  bool simple = false; // the triangles are only made of the ring vertices and cover it exactly
+  size_t localUpdates_ = 0;
+  size_t rebuilds_ = 0;
+};
+
+} // namespace ear_clip
@@ -0,0 +1,337 @@
+#include "intersection_search.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <thread>
+#include <tuple>
+
+namespace ear_clip::details {
+
+namespace {
+
+// Smaller inputs are searched by the plain loop in one thread
+constexpr size_t PARTITION_MIN_SEGMENTS = 4096;
+// Cells(or loop rows) a worker takes at once
+constexpr size_t TASK_SIZE = 64;
+// Longer segments make the grid too large
+constexpr size_t MAX_CELLS_PER_SEGMENT = 16;
+
+struct Box {
+  double left, bottom, right, top;
+};
+
+Box bounds(const Segment &s) {
+  return {std::min(s.from.x, s.to.x), std::min(s.from.y, s.to.y),
+          std::max(s.from.x, s.to.x), std::max(s.from.y, s.to.y)};
+}
+
+bool overlap(const Box &a, const Box &b) {
+  return a.left <= b.right && b.left <= a.right && a.bottom <= b.top && b.bottom <= a.top;
+}
+
+// The segments can only cross if their boxes overlap. False if the crossing point can't be computed.
+bool test(const std::pmr::vector<Segment> &segments, const std::pmr::vector<Box> &boxes, size_t i, size_t j,
+          std::pmr::vector<Crossing> &result) {
+  if (!overlap(boxes[i], boxes[j]))
+    return true;
+  const auto &a = segments[i], &b = segments[j];
+  if (!intersects(a.from, a.to, b.from, b.to))
+    return true;
+  auto p = tryIntersection(a.from, a.to, b.from, b.to);
+  if (p)
+    result.push_back({i, j, *p});
+  return p.has_value();
+}
+
+bool cancelled(const std::atomic<bool> *cancel) {
+  return cancel && cancel->load(std::memory_order_relaxed);
+}
+
+// Runs work(thread, task) for the tasks [0, tasks) on the threads, the calling
+// one included. The first failed task(not OK status) stops the others.
+template <class Work>
+Status runTasks(size_t threads, size_t tasks, Work work, std::pmr::memory_resource *memory) {
+  std::pmr::vector<Status> statuses(threads, Status::OK, memory);
+  std::atomic<size_t> nextTask = 0;
+  auto worker = [&](size_t thread) {
+    for (auto task = nextTask.fetch_add(TASK_SIZE); task < tasks; task = nextTask.fetch_add(TASK_SIZE)) {
+      for (auto end = std::min(task + TASK_SIZE, tasks); task < end; ++task) {
+        statuses[thread] = work(thread, task);
+        if (statuses[thread] != Status::OK) {
+          nextTask = tasks;
+          return;
+        }
+      }
+    }
+  };
+
+  {
+    std::pmr::vector<std::thread> workers(memory);
+    workers.reserve(threads - 1);
+    for (size_t thread = 1; thread < threads; ++thread)
+      workers.emplace_back(worker, thread);
+    worker(0);
+    for (auto &w : workers)
+      w.join();
+  }
+
+  return *std::max_element(statuses.begin(), statuses.end());
+}
+
+// Uniform grid of the segment boxes, a segment is in every cell its box overlaps
+class SegmentGrid {
+ public:
+  SegmentGrid(const std::pmr::vector<Box> &boxes, std::pmr::memory_resource *memory)
+      : ranges(memory), offsets(memory), entries(memory) {
+    left = bottom = std::numeric_limits<double>::max();
+    double right = std::numeric_limits<double>::lowest(), top = right;
+    for (const auto &box : boxes) {
+      left = std::min(left, box.left);
+      right = std::max(right, box.right);
+      bottom = std::min(bottom, box.bottom);
+      top = std::max(top, box.top);
+    }
+    auto count = boxes.size();
+    auto side = std::max(std::sqrt((right - left) * (top - bottom) / static_cast<double>(count)),
+                         std::numeric_limits<double>::min());
+    // Clamped before the cast: a line of segments has no area, so the side is tiny
+    auto limit = static_cast<double>(count);
+    columns = std::max<size_t>(static_cast<size_t>(std::min((right - left) / side, limit)), 1);
+    rows = std::max<size_t>(static_cast<size_t>(std::min((top - bottom) / side, limit)), 1);
+    cellWidth = std::max((right - left) / static_cast<double>(columns), std::numeric_limits<double>::min());
+    cellHeight = std::max((top - bottom) / static_cast<double>(rows), std::numeric_limits<double>::min());
+
+    ranges.reserve(count);
+    for (const auto &box : boxes) {
+      const auto &range = ranges.emplace_back(Range{column(box.left), column(box.right), row(box.bottom), row(box.top)});
+      size_ += (range.c1 - range.c0 + 1) * (range.r1 - range.r0 + 1);
+    }
+  }
+
+  // Fills the cells, it takes O(size())
+  void index() {
+    offsets.assign(cells() + 1, 0);
+    for (const auto &range : ranges) {
+      for (auto r = range.r0; r <= range.r1; ++r) {
+        for (auto c = range.c0; c <= range.c1; ++c)
+          offsets[cell(c, r) + 1]++;
+      }
+    }
+    for (size_t c = 0; c + 1 < offsets.size(); ++c)
+      offsets[c + 1] += offsets[c];
+    entries.resize(offsets.back());
+    std::pmr::vector<size_t> cursor(offsets.begin(), offsets.end() - 1, offsets.get_allocator());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      const auto &range = ranges[i];
+      for (auto r = range.r0; r <= range.r1; ++r) {
+        for (auto c = range.c0; c <= range.c1; ++c)
+          entries[cursor[cell(c, r)]++] = i;
+      }
+    }
+  }
+
+  [[nodiscard]] size_t cells() const { return columns * rows; }
+  // Segments in all the cells
+  [[nodiscard]] size_t size() const { return size_; }
+
+  // Segment pairs tested by the cells
+  [[nodiscard]] double pairs() const {
+    double result = 0;
+    for (size_t c = 0; c < cells(); ++c) {
+      auto size = static_cast<double>(offsets[c + 1] - offsets[c]);
+      result += size * (size - 1) / 2;
+    }
+    return result;
+  }
+
+  // Calls f(i, j), i < j, for the pairs which have this cell as the first common one
+  template <class F>
+  void forEachPair(size_t c, F &&f) const {
+    for (auto k = offsets[c]; k < offsets[c + 1]; ++k) {
+      for (auto l = k + 1; l < offsets[c + 1]; ++l) {
+        auto i = entries[k], j = entries[l]; // the segments were added in order, so i < j
+        const auto &a = ranges[i], &b = ranges[j];
+        if (cell(std::max(a.c0, b.c0), std::max(a.r0, b.r0)) == c)
+          f(i, j);
+      }
+    }
+  }
+
+ private:
+  struct Range {
+    size_t c0, c1, r0, r1;
+  };
+
+  [[nodiscard]] size_t column(double x) const {
+    return std::min(columns - 1, static_cast<size_t>(std::max(0.0, (x - left) / cellWidth)));
+  }
+  [[nodiscard]] size_t row(double y) const {
+    return std::min(rows - 1, static_cast<size_t>(std::max(0.0, (y - bottom) / cellHeight)));
+  }
+  [[nodiscard]] size_t cell(size_t c, size_t r) const { return r * columns + c; }
+
+  double left, bottom, cellWidth, cellHeight;
+  size_t columns, rows;
+  size_t size_ = 0;
+  std::pmr::vector<Range> ranges;
+  std::pmr::vector<size_t> offsets, entries; // CSR: segments per cell
+};
+
+// The segment pairs split into units: the loop rows or the grid cells
+class SearchPlan {
+ public:
+  enum class Units {
+    ROWS,        // row i - pairs (i, j > i), the crossings come in order
+    PAIRED_ROWS, // unit t - rows t and count - 1 - t, as the rows get shorter
+    CELLS        // the pairs which have the cell as the first common one
+  };
+
+  // rows - the loop rows units if the grid isn't used
+  SearchPlan(const std::pmr::vector<Segment> &segments, bool partition, Units rows, std::pmr::memory_resource *memory)
+      : segments(segments), boxes(memory), units_(rows) {
+    boxes.reserve(segments.size());
+    for (const auto &s : segments)
+      boxes.push_back(bounds(s));
+    auto count = segments.size();
+    if (!partition || count < 2)
+      return;
+
+    // The grid is only worth it if the segments are short enough
+    grid.emplace(boxes, memory);
+    if (grid->size() <= MAX_CELLS_PER_SEGMENT * count) {
+      grid->index();
+      if (grid->pairs() < static_cast<double>(count) * static_cast<double>(count - 1) / 2) {
+        units_ = Units::CELLS;
+        return;
+      }
+    }
+    grid.reset();
+  }
+
+  [[nodiscard]] Units units() const { return units_; }
+
+  [[nodiscard]] size_t size() const {
+    switch (units_) {
+      case Units::ROWS:return segments.size();
+      case Units::PAIRED_ROWS:return (segments.size() + 1) / 2;
+      case Units::CELLS:return grid->cells();
+    }
+    return 0;
+  }
+
+  // Tests the unit pairs, adds their count to tested. False if a crossing point can't be computed.
+  bool search(size_t unit, std::pmr::vector<Crossing> &result, size_t &tested) const {
+    bool ok = true;
+    auto count = segments.size();
+    auto row = [&](size_t i) {
+      for (size_t j = i + 1; j < count; ++j)
+        ok &= test(segments, boxes, i, j, result);
+      tested += count - 1 - i;
+    };
+    switch (units_) {
+      case Units::ROWS:row(unit);
+        break;
+      case Units::PAIRED_ROWS:row(unit);
+        if (count - 1 - unit != unit)
+          row(count - 1 - unit);
+        break;
+      case Units::CELLS:
+        grid->forEachPair(unit, [&](size_t i, size_t j) {
+          ok &= test(segments, boxes, i, j, result);
+          tested++;
+        });
+        break;
+    }
+    return ok;
+  }
+
+ private:
+  const std::pmr::vector<Segment> &segments;
+  std::pmr::vector<Box> boxes;
+  std::optional<SegmentGrid> grid;
+  Units units_;
+};
+
+void sortCrossings(std::pmr::vector<Crossing> &crossings) {
+  std::sort(crossings.begin(), crossings.end(), [](const Crossing &a, const Crossing &b) {
+    return std::tie(a.first, a.second) < std::tie(b.first, b.second);
+  });
+}
+
+} // namespace
+
+struct CrossingSearch::Plan : SearchPlan {
+  using SearchPlan::SearchPlan;
+};
+
+CrossingSearch::CrossingSearch(const std::pmr::vector<Segment> &segments, std::pmr::memory_resource *memory)
+    : plan(std::make_unique<Plan>(segments, segments.size() >= PARTITION_MIN_SEGMENTS, SearchPlan::Units::ROWS,
+                                  memory)),
+      crossings_(memory) {}
+
+CrossingSearch::~CrossingSearch() = default;
+
+Status CrossingSearch::advance(size_t &work) {
+  while (!done() && work != 0) {
+    size_t tested = 0;
+    if (!plan->search(next++, crossings_, tested)) {
+      crossings_.clear();
+      next = plan->size();
+      return Status::NUMERIC_FAILURE;
+    }
+    work -= std::min(work, std::max<size_t>(tested, 1));
+  }
+  if (done() && plan->units() == SearchPlan::Units::CELLS && !sorted) {
+    sortCrossings(crossings_);
+    sorted = true;
+  }
+  return Status::OK;
+}
+
+bool CrossingSearch::done() const {
+  return next >= plan->size();
+}
+
+Result<std::pmr::vector<Crossing>> findCrossings(const std::pmr::vector<Segment> &segments, size_t threads,
+                                                 const std::atomic<bool> *cancel,
+                                                 std::pmr::memory_resource *memory) noexcept {
+  Result<std::pmr::vector<Crossing>> result{Status::OK, std::pmr::vector<Crossing>(memory)};
+  auto &crossings = result.value;
+  auto fail = [&](Status status) {
+    result.status = status;
+    crossings.clear();
+    return std::move(result);
+  };
+
+  threads = std::max<size_t>(threads, 1);
+  auto count = segments.size();
+  SearchPlan plan(segments, threads > 1 || count >= PARTITION_MIN_SEGMENTS,
+                  threads == 1 ? SearchPlan::Units::ROWS : SearchPlan::Units::PAIRED_ROWS, memory);
+  std::pmr::vector<std::pmr::vector<Crossing>> found(threads, memory);
+  auto status = runTasks(threads, plan.size(), [&](size_t thread, size_t unit) {
+    if (unit % TASK_SIZE == 0 && cancelled(cancel))
+      return Status::CANCELLED;
+    size_t tested = 0;
+    return plan.search(unit, found[thread], tested) ? Status::OK : Status::NUMERIC_FAILURE;
+  }, memory);
+  if (status != Status::OK)
+    return fail(status);
+
+  if (threads == 1) {
+    crossings = std::move(found[0]);
+  } else {
+    size_t total = 0;
+    for (const auto &f : found)
+      total += f.size();
+    crossings.reserve(total);
+    for (const auto &f : found)
+      crossings.insert(crossings.end(), f.begin(), f.end());
+  }
+  if (plan.units() != SearchPlan::Units::ROWS)
+    sortCrossings(crossings);
+  return result;
+}
+
+} // namespace ear_clip::details
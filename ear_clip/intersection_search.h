@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ear_clip.h"
+
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace ear_clip::details {
+
+struct Segment {
+  Point from, to;
+};
+
+// Segments first < second which cross(see intersects()) at the point
+struct Crossing {
+  size_t first, second;
+  Point point;
+};
+
+// All the crossing segment pairs, ordered by (first, second). It's the
+// order of the plain loop over the pairs, so the callers may weld the points
+// in it.
+//
+// With one thread and less than 4096 segments it's that loop. Otherwise the
+// segments are bucketed by their bounding boxes into a grid of about one cell
+// per segment, and the cells are searched by the worker threads. A pair is
+// tested in the first cell they share only. If the segments are long enough
+// for the cells to hold more pairs than the plain loop(e.g. a star), the loop
+// rows are split between the threads instead. Either way the result is the same.
+//
+// The status is OK, CANCELLED or NUMERIC_FAILURE(the crossings are empty
+// then). memory must be thread safe if threads > 1.
+Result<std::pmr::vector<Crossing>> findCrossings(const std::pmr::vector<Segment> &segments, size_t threads,
+                                                 const std::atomic<bool> *cancel,
+                                                 std::pmr::memory_resource *memory) noexcept;
+
+// The findCrossings() search in one thread and in parts, for the callers
+// which can't block for the whole of it. The segments must outlive it.
+class CrossingSearch {
+ public:
+  CrossingSearch(const std::pmr::vector<Segment> &segments, std::pmr::memory_resource *memory);
+  ~CrossingSearch();
+
+  // Tests the segment pairs until the work(a pair test) is spent or the
+  // search is done. A unit(a loop row or a grid cell) is finished even if it
+  // overruns. OK or NUMERIC_FAILURE, the search is done then.
+  Status advance(size_t &work);
+  [[nodiscard]] bool done() const;
+  // The findCrossings() result once done
+  [[nodiscard]] const std::pmr::vector<Crossing> &crossings() const { return crossings_; }
+
+ private:
+  struct Plan;
+
+  std::unique_ptr<Plan> plan;
+  size_t next = 0; // unit
+  bool sorted = false;
+  std::pmr::vector<Crossing> crossings_;
+};
+
+} // namespace ear_clip::details
@@ -0,0 +1,57 @@
+#include "memory_resources.h"
+
+#include <algorithm>
+
+namespace ear_clip::details {
+
+CountingResource::CountingResource(std::pmr::memory_resource *upstream)
+    : upstream(upstream) {}
+
+void CountingResource::account(size_t bytes, size_t allocationsCount) {
+  allocations += allocationsCount;
+  totalBytes += bytes;
+  peakBytes = std::max(peakBytes, currentBytes + bytes);
+}
+
+void CountingResource::report(TriangulationStats &stats) const {
+  stats.allocations += allocations;
+  stats.allocatedBytes += totalBytes;
+  stats.peakBytes = std::max(stats.peakBytes, peakBytes);
+}
+
+void *CountingResource::do_allocate(size_t bytes, size_t alignment) {
+  auto p = upstream->allocate(bytes, alignment);
+  allocations++;
+  totalBytes += bytes;
+  currentBytes += bytes;
+  peakBytes = std::max(peakBytes, currentBytes);
+  return p;
+}
+
+void CountingResource::do_deallocate(void *p, size_t bytes, size_t alignment) {
+  upstream->deallocate(p, bytes, alignment);
+  currentBytes -= bytes;
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+  return this == &other;
+}
+
+LockingResource::LockingResource(std::pmr::memory_resource *upstream)
+    : upstream(upstream) {}
+
+void *LockingResource::do_allocate(size_t bytes, size_t alignment) {
+  std::lock_guard lock(mutex);
+  return upstream->allocate(bytes, alignment);
+}
+
+void LockingResource::do_deallocate(void *p, size_t bytes, size_t alignment) {
+  std::lock_guard lock(mutex);
+  upstream->deallocate(p, bytes, alignment);
+}
+
+bool LockingResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+  return this == &other;
+}
+
+} // namespace ear_clip::details
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ear_clip.h"
+
+#include <memory_resource>
+#include <mutex>
+
+namespace ear_clip::details {
+
+// Forwards to the upstream resource and counts what goes through it
+class CountingResource : public std::pmr::memory_resource {
+ public:
+  explicit CountingResource(std::pmr::memory_resource *upstream);
+
+  // Adds memory allocated "outside", e.g. by a container which outlives the resource
+  void account(size_t bytes, size_t allocationsCount = 1);
+  void report(TriangulationStats &stats) const;
+
+ private:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+  [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+  std::pmr::memory_resource *upstream;
+  size_t allocations = 0;
+  size_t totalBytes = 0;
+  size_t currentBytes = 0;
+  size_t peakBytes = 0;
+};
+
+// Makes a memory resource safe to share between threads
+class LockingResource : public std::pmr::memory_resource {
+ public:
+  explicit LockingResource(std::pmr::memory_resource *upstream);
+
+ private:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+  [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+  std::pmr::memory_resource *upstream;
+  std::mutex mutex;
+};
+
+} // namespace ear_clip::details
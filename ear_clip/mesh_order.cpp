@@ -0,0 +1,363 @@
+#include "mesh_order.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace ear_clip {
+
+namespace {
+
+constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+size_t verticesCount(const std::pmr::vector<Mesh::Indices> &triangles) {
+  uint32_t count = 0;
+  for (const auto &t : triangles)
+    count = std::max({count, t[0] + 1, t[1] + 1, t[2] + 1});
+  return count;
+}
+
+// FIFO vertex cache simulation: a vertex is in the cache if fewer than
+// cacheSize misses happened since it was loaded
+class VertexCache {
+ public:
+  VertexCache(size_t vertices, size_t cacheSize, std::pmr::memory_resource *memory)
+      : loaded(vertices, NOT_LOADED, memory), cacheSize(cacheSize) {}
+
+  void fetch(uint32_t vertex) {
+    if (loaded[vertex] != NOT_LOADED && misses - loaded[vertex] < cacheSize)
+      return;
+    loaded[vertex] = misses++;
+  }
+
+  size_t misses = 0;
+
+ private:
+  static constexpr size_t NOT_LOADED = SIZE_MAX;
+
+  std::pmr::vector<size_t> loaded;
+  size_t cacheSize;
+};
+
+// Puts the triangles in the order(new index -> old index) and remaps the neighbours
+void applyOrder(Mesh &mesh, const std::pmr::vector<uint32_t> &order) {
+  auto memory = mesh.triangles.get_allocator().resource();
+  std::pmr::vector<uint32_t> newIndex(order.size(), memory);
+  for (uint32_t i = 0; i < order.size(); ++i)
+    newIndex[order[i]] = i;
+
+  std::pmr::vector<Mesh::Indices> triangles(memory), neighbours(memory);
+  std::pmr::vector<Mesh::Flags> constrained(memory);
+  triangles.reserve(order.size());
+  neighbours.reserve(order.size());
+  constrained.reserve(order.size());
+  for (auto old : order) {
+    triangles.push_back(mesh.triangles[old]);
+    auto n = mesh.neighbours[old];
+    for (auto &i : n)
+      i = i == Mesh::NO_NEIGHBOUR ? Mesh::NO_NEIGHBOUR : newIndex[i];
+    neighbours.push_back(n);
+    constrained.push_back(mesh.constrained[old]);
+  }
+  mesh.triangles = std::move(triangles);
+  mesh.neighbours = std::move(neighbours);
+  mesh.constrained = std::move(constrained);
+}
+
+// Index of the point on the Hilbert curve of the 2^16 x 2^16 grid
+uint64_t hilbertIndex(uint32_t x, uint32_t y) {
+  constexpr uint32_t n = 1u << 16;
+  uint64_t d = 0;
+  for (uint32_t s = n / 2; s > 0; s /= 2) {
+    uint32_t rx = (x & s) > 0;
+    uint32_t ry = (y & s) > 0;
+    d += uint64_t(s) * s * ((3 * rx) ^ ry);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = n - 1 - x;
+        y = n - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return d;
+}
+
+// Builds strips or fans: each one starts at the first free triangle and is
+// grown across the neighbours, the start rotation giving the longest run wins
+template <class Grow>
+std::pmr::vector<uint32_t> buildRuns(const Mesh &mesh, std::pmr::memory_resource *memory, Grow grow) {
+  std::pmr::vector<uint32_t> result(memory);
+  std::pmr::vector<bool> used(mesh.triangles.size(), false, memory);
+  std::pmr::vector<uint32_t> run(memory), touched(memory);
+
+  // The free neighbour of the triangle across the edge p-q or NO_INDEX, and its third vertex
+  auto across = [&](uint32_t t, uint32_t p, uint32_t q) -> std::pair<uint32_t, uint32_t> {
+    const auto &triangle = mesh.triangles[t];
+    for (size_t i = 0; i < 3; ++i) {
+      auto a = triangle[i], b = triangle[(i + 1) % 3];
+      if ((a == p && b == q) || (a == q && b == p)) {
+        auto n = mesh.neighbours[t][i];
+        if (n == Mesh::NO_NEIGHBOUR || used[n])
+          return {NO_INDEX, NO_INDEX};
+        for (auto v : mesh.triangles[n]) {
+          if (v != p && v != q)
+            return {n, v};
+        }
+      }
+    }
+    return {NO_INDEX, NO_INDEX};
+  };
+
+  // Grows the run from the rotated triangle, the used triangles are recorded in touched
+  auto runFrom = [&](uint32_t t, size_t rotation) {
+    const auto &triangle = mesh.triangles[t];
+    run.assign({triangle[rotation], triangle[(rotation + 1) % 3], triangle[(rotation + 2) % 3]});
+    touched.assign({t});
+    used[t] = true;
+    grow(t, run, touched, used, across);
+  };
+
+  for (uint32_t t = 0; t < mesh.triangles.size(); ++t) {
+    if (used[t])
+      continue;
+
+    size_t bestRotation = 0, bestSize = 0;
+    for (size_t rotation = 0; rotation < 3; ++rotation) {
+      runFrom(t, rotation);
+      if (run.size() > bestSize) {
+        bestSize = run.size();
+        bestRotation = rotation;
+      }
+      for (auto u : touched)
+        used[u] = false;
+    }
+
+    runFrom(t, bestRotation);
+    if (!result.empty())
+      result.push_back(PRIMITIVE_RESTART);
+    result.insert(result.end(), run.begin(), run.end());
+  }
+
+  return result;
+}
+
+} // namespace
+
+double acmr(const std::pmr::vector<Mesh::Indices> &triangles, size_t cacheSize) {
+  if (triangles.empty())
+    return 0;
+
+  VertexCache cache(verticesCount(triangles), cacheSize, triangles.get_allocator().resource());
+  for (const auto &t : triangles) {
+    for (auto v : t)
+      cache.fetch(v);
+  }
+  return static_cast<double>(cache.misses) / static_cast<double>(triangles.size());
+}
+
+double acmr(const std::pmr::vector<uint32_t> &indices, Primitive primitive, size_t cacheSize) {
+  if (primitive == Primitive::TRIANGLES) {
+    std::pmr::vector<Mesh::Indices> triangles(indices.get_allocator().resource());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+      triangles.push_back({indices[i], indices[i + 1], indices[i + 2]});
+    return acmr(triangles, cacheSize);
+  }
+
+  uint32_t vertices = 0;
+  for (auto i : indices) {
+    if (i != PRIMITIVE_RESTART)
+      vertices = std::max(vertices, i + 1);
+  }
+  VertexCache cache(vertices, cacheSize, indices.get_allocator().resource());
+  size_t triangles = 0, run = 0;
+  for (auto i : indices) {
+    if (i == PRIMITIVE_RESTART) {
+      run = 0;
+      continue;
+    }
+    cache.fetch(i);
+    if (++run > 2)
+      triangles++;
+  }
+  return triangles == 0 ? 0 : static_cast<double>(cache.misses) / static_cast<double>(triangles);
+}
+
+void reorderForVertexCache(Mesh &mesh, size_t cacheSize) {
+  const auto &triangles = mesh.triangles;
+  auto memory = triangles.get_allocator().resource();
+  auto vertices = verticesCount(triangles);
+
+  // Vertex -> triangles
+  std::pmr::vector<uint32_t> offsets(vertices + 1, 0, memory), incident(triangles.size() * 3, memory);
+  for (const auto &t : triangles) {
+    for (auto v : t)
+      offsets[v + 1]++;
+  }
+  for (size_t v = 0; v < vertices; ++v)
+    offsets[v + 1] += offsets[v];
+  {
+    std::pmr::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1, memory);
+    for (uint32_t t = 0; t < triangles.size(); ++t) {
+      for (auto v : triangles[t])
+        incident[cursor[v]++] = t;
+    }
+  }
+
+  // Triangles not emitted yet per vertex
+  std::pmr::vector<uint32_t> live(vertices, memory);
+  for (size_t v = 0; v < vertices; ++v)
+    live[v] = offsets[v + 1] - offsets[v];
+
+  auto size = static_cast<int64_t>(cacheSize);
+  std::pmr::vector<int64_t> cacheTime(vertices, 0, memory);
+  std::pmr::vector<bool> emitted(triangles.size(), false, memory);
+  std::pmr::vector<uint32_t> deadEnd(memory), candidates(memory), order(memory);
+  order.reserve(triangles.size());
+  int64_t time = size + 1;
+  uint32_t cursor = 0;
+
+  auto nextVertex = [&]() {
+    // The candidate which stays in the cache while its remaining triangles are emitted, the oldest one
+    uint32_t best = NO_INDEX;
+    int64_t bestPriority = -1;
+    for (auto v : candidates) {
+      if (live[v] == 0)
+        continue;
+      int64_t priority = 0;
+      if (time - cacheTime[v] + 2 * static_cast<int64_t>(live[v]) <= size)
+        priority = time - cacheTime[v];
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        best = v;
+      }
+    }
+    if (best != NO_INDEX)
+      return best;
+
+    // The recently used vertices, then the next vertex in the input order
+    while (!deadEnd.empty()) {
+      auto v = deadEnd.back();
+      deadEnd.pop_back();
+      if (live[v] > 0)
+        return v;
+    }
+    for (; cursor < vertices; ++cursor) {
+      if (live[cursor] > 0)
+        return cursor;
+    }
+    return NO_INDEX;
+  };
+
+  for (auto fanning = vertices == 0 ? NO_INDEX : uint32_t(0); fanning != NO_INDEX; fanning = nextVertex()) {
+    candidates.clear();
+    for (auto i = offsets[fanning]; i < offsets[fanning + 1]; ++i) {
+      auto t = incident[i];
+      if (emitted[t])
+        continue;
+      for (auto v : triangles[t]) {
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if (time - cacheTime[v] > size)
+          cacheTime[v] = time++;
+      }
+      emitted[t] = true;
+      order.push_back(t);
+    }
+  }
+
+  applyOrder(mesh, order);
+}
+
+void reorderAlongHilbertCurve(Mesh &mesh) {
+  const auto &triangles = mesh.triangles;
+  auto memory = triangles.get_allocator().resource();
+  if (triangles.empty())
+    return;
+
+  std::pmr::vector<Point> centroids(memory);
+  centroids.reserve(triangles.size());
+  double left = std::numeric_limits<double>::max(), bottom = left;
+  double right = std::numeric_limits<double>::lowest(), top = right;
+  for (const auto &t : triangles) {
+    const auto &a = mesh.vertices[t[0]], &b = mesh.vertices[t[1]], &c = mesh.vertices[t[2]];
+    Point centroid{(a.x + b.x + c.x) / 3, (a.y + b.y + c.y) / 3};
+    left = std::min(left, centroid.x);
+    right = std::max(right, centroid.x);
+    bottom = std::min(bottom, centroid.y);
+    top = std::max(top, centroid.y);
+    centroids.push_back(centroid);
+  }
+
+  constexpr double GRID = (1u << 16) - 1;
+  auto scale = GRID / std::max({right - left, top - bottom, std::numeric_limits<double>::min()});
+  std::pmr::vector<std::pair<uint64_t, uint32_t>> keys(memory);
+  keys.reserve(triangles.size());
+  for (uint32_t t = 0; t < triangles.size(); ++t) {
+    auto x = static_cast<uint32_t>(std::clamp((centroids[t].x - left) * scale, 0.0, GRID));
+    auto y = static_cast<uint32_t>(std::clamp((centroids[t].y - bottom) * scale, 0.0, GRID));
+    keys.emplace_back(hilbertIndex(x, y), t);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::pmr::vector<uint32_t> order(memory);
+  order.reserve(keys.size());
+  for (const auto &key : keys)
+    order.push_back(key.second);
+  applyOrder(mesh, order);
+}
+
+std::pmr::vector<uint32_t> triangleStrips(const Mesh &mesh, std::pmr::memory_resource *memory) {
+  // The strip goes on across the edge of its last two vertices
+  return buildRuns(mesh, memory, [](uint32_t t, auto &run, auto &touched, auto &used, auto &across) {
+    for (;;) {
+      auto [n, v] = across(t, run[run.size() - 2], run.back());
+      if (n == NO_INDEX)
+        return;
+      run.push_back(v);
+      touched.push_back(n);
+      used[n] = true;
+      t = n;
+    }
+  });
+}
+
+std::pmr::vector<uint32_t> triangleFans(const Mesh &mesh, std::pmr::memory_resource *memory) {
+  // The fan goes on across the edge of its center and the last vertex
+  return buildRuns(mesh, memory, [](uint32_t t, auto &run, auto &touched, auto &used, auto &across) {
+    for (;;) {
+      auto [n, v] = across(t, run.front(), run.back());
+      if (n == NO_INDEX)
+        return;
+      run.push_back(v);
+      touched.push_back(n);
+      used[n] = true;
+      t = n;
+    }
+  });
+}
+
+std::pmr::vector<Mesh::Indices> unpack(const std::pmr::vector<uint32_t> &indices, Primitive primitive,
+                                       std::pmr::memory_resource *memory) {
+  std::pmr::vector<Mesh::Indices> result(memory);
+  if (primitive == Primitive::TRIANGLES) {
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+      result.push_back({indices[i], indices[i + 1], indices[i + 2]});
+    return result;
+  }
+
+  for (size_t begin = 0, end = 0; begin < indices.size(); begin = end + 1) {
+    end = std::find(indices.begin() + begin, indices.end(), PRIMITIVE_RESTART) - indices.begin();
+    for (auto k = begin; k + 2 < end; ++k) {
+      if (primitive == Primitive::TRIANGLE_FAN)
+        result.push_back({indices[begin], indices[k + 1], indices[k + 2]});
+      else if ((k - begin) % 2 == 0)
+        result.push_back({indices[k], indices[k + 1], indices[k + 2]});
+      else
+        result.push_back({indices[k + 1], indices[k], indices[k + 2]});
+    }
+  }
+  return result;
+}
+
+} // namespace ear_clip
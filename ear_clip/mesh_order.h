@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ear_clip.h"
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace ear_clip {
+
+// Post-processing of the triangulateMesh() output for the renderer
+
+// Separates the strips(fans) in an index buffer
+constexpr uint32_t PRIMITIVE_RESTART = UINT32_MAX;
+
+enum class Primitive {
+  TRIANGLES,
+  TRIANGLE_STRIP,
+  TRIANGLE_FAN
+};
+
+// Average cache miss ratio: post-transform vertex cache(FIFO of the size)
+// misses per triangle. 0.5 is the best possible for a large regular mesh, 3 - the worst.
+double acmr(const std::pmr::vector<Mesh::Indices> &triangles, size_t cacheSize = 16);
+// The same for an index buffer of the primitive with PRIMITIVE_RESTART
+double acmr(const std::pmr::vector<uint32_t> &indices, Primitive primitive, size_t cacheSize = 16);
+
+// Reorders the triangles for the post-transform vertex cache(Tipsify,
+// Sander et al. 2007), linear time. The neighbours are remapped.
+void reorderForVertexCache(Mesh &mesh, size_t cacheSize = 16);
+// Reorders the triangles by the Hilbert curve index of their centroids for
+// the spatial locality. The neighbours are remapped.
+void reorderAlongHilbertCurve(Mesh &mesh);
+
+// The triangles as strips joined by PRIMITIVE_RESTART. A strip is grown
+// across the neighbours, the triangles keep their orientation.
+std::pmr::vector<uint32_t> triangleStrips(const Mesh &mesh,
+                                          std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+// The triangles as fans joined by PRIMITIVE_RESTART. The ear clipping emits
+// runs of triangles around one vertex, they become one fan.
+std::pmr::vector<uint32_t> triangleFans(const Mesh &mesh,
+                                        std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+
+// Triangles of the index buffer, for checks
+std::pmr::vector<Mesh::Indices> unpack(const std::pmr::vector<uint32_t> &indices, Primitive primitive,
+                                       std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+
+} // namespace ear_clip
@@ -0,0 +1,160 @@
+#include "planar_graph.h"
+
+#include "delaunay.h"
+
+#include <algorithm>
+
+namespace ear_clip::details {
+
+namespace {
+
+// The sign is exact: it's orient() of the vectors ends and the origin
+double cross(Point a, Point b) {
+  return orient(a, b, {0, 0});
+}
+
+// Only the sign for the collinear vectors is used, their products have the
+// same sign then, so nothing cancels and the rounded sum has the exact one
+double dot(Point a, Point b) {
+  return a.x * b.x + a.y * b.y;
+}
+
+Point direction(Point from, Point to) {
+  return {to.x - from.x, to.y - from.y};
+}
+
+// 0 - the clockwise angle from the reference is in [0, PI), 1 - in [PI, 2PI)
+int halfPlane(Point reference, Point v) {
+  auto c = cross(reference, v);
+  return c < 0 || (c == 0 && dot(reference, v) > 0) ? 0 : 1;
+}
+
+} // namespace
+
+bool clockwiseLess(Point reference, Point l, Point r) {
+  auto lHalf = halfPlane(reference, l);
+  auto rHalf = halfPlane(reference, r);
+  if (lHalf != rHalf)
+    return lHalf < rHalf;
+
+  return cross(l, r) < 0;
+}
+
+PlanarGraph::PlanarGraph(const std::pmr::vector<Point> &nodes, const Edges &edges,
+                         std::pmr::memory_resource *memory)
+    : nodes(nodes), offsets(nodes.size() + 1, 0, memory), edges_(memory) {
+  for (const auto &e : edges) {
+    if (!e)
+      continue;
+    offsets[e->first + 1]++;
+    offsets[e->second + 1]++;
+  }
+  for (size_t i = 1; i < offsets.size(); ++i)
+    offsets[i] += offsets[i - 1];
+
+  edges_.resize(offsets.back());
+  {
+    std::pmr::vector<size_t> cursor(offsets.begin(), std::prev(offsets.end()), memory);
+    for (size_t i = 0; i < edges.size(); ++i) {
+      if (!edges[i])
+        continue;
+      auto [a, b] = *edges[i];
+      edges_[cursor[a]++] = {b, i, 0};
+      edges_[cursor[b]++] = {a, i, 0};
+    }
+  }
+
+  const Point reference{-1, 0};
+  for (size_t node = 0; node < nodesCount(); ++node) {
+    auto origin = nodes[node];
+    std::sort(edges_.begin() + offsets[node], edges_.begin() + offsets[node + 1],
+              [&](const HalfEdge &l, const HalfEdge &r) {
+                auto lDir = direction(origin, nodes[l.to]);
+                auto rDir = direction(origin, nodes[r.to]);
+                if (clockwiseLess(reference, lDir, rDir))
+                  return true;
+                if (clockwiseLess(reference, rDir, lDir))
+                  return false;
+                return l.edge < r.edge; // the same direction
+              });
+  }
+
+  // Both half edges of an edge are found after the sort, they are twins
+  std::pmr::vector<size_t> firstHalf(edges.size(), SIZE_MAX, memory);
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    auto &first = firstHalf[edges_[i].edge];
+    if (first == SIZE_MAX) {
+      first = i;
+    } else {
+      edges_[first].twin = i;
+      edges_[i].twin = first;
+    }
+  }
+}
+
+PlanarGraph::Range PlanarGraph::halfEdges(size_t node) const {
+  return {edges_.data() + offsets[node], edges_.data() + offsets[node + 1]};
+}
+
+size_t PlanarGraph::clockwiseFrom(size_t node, Point dir) const {
+  auto range = halfEdges(node);
+  auto origin = nodes[node];
+  size_t result = 0;
+  for (size_t i = 1; i < range.size(); ++i) {
+    if (clockwiseLess(dir, direction(origin, nodes[range[i].to]), direction(origin, nodes[range[result].to])))
+      result = i;
+  }
+
+  return result;
+}
+
+PlanarGraph::Faces PlanarGraph::faces(std::pmr::memory_resource *memory) const {
+  Faces result(memory);
+  auto walk = walkFaces(memory);
+  for (size_t face = 0; face < walk.size(); ++face) {
+    if (walk.doubleAreas[face] <= 0)
+      continue;
+
+    auto &nodeIds = result.emplace_back();
+    for (auto i = walk.offsets[face]; i < walk.offsets[face + 1]; ++i)
+      nodeIds.push_back(from(walk.halfEdges[i]));
+  }
+
+  return result;
+}
+
+PlanarGraph::FaceWalk PlanarGraph::walkFaces(std::pmr::memory_resource *memory) const {
+  constexpr size_t NO_FACE = SIZE_MAX;
+  FaceWalk result(memory);
+  result.halfEdges.reserve(edges_.size());
+  result.faceOf.assign(edges_.size(), NO_FACE);
+  result.offsets.push_back(0);
+  for (size_t start = 0; start < edges_.size(); ++start) {
+    if (result.faceOf[start] != NO_FACE)
+      continue;
+
+    auto face = result.doubleAreas.size();
+    double doubleArea = 0;
+    auto h = start;
+    do {
+      result.faceOf[h] = face;
+      result.halfEdges.push_back(h);
+      const auto &halfEdge = edges_[h];
+      auto a = nodes[from(h)];
+      auto b = nodes[halfEdge.to];
+      doubleArea += a.x * b.y - b.x * a.y;
+
+      // the most left turn: the next clockwise half edge after the way back
+      auto node = halfEdge.to;
+      auto degree = offsets[node + 1] - offsets[node];
+      h = offsets[node] + (halfEdge.twin - offsets[node] + 1) % degree;
+    } while (h != start);
+
+    result.doubleAreas.push_back(doubleArea);
+    result.offsets.push_back(result.halfEdges.size());
+  }
+
+  return result;
+}
+
+} // namespace ear_clip::details
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ear_clip.h"
+
+#include <memory_resource>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace ear_clip::details {
+
+// Compressed(CSR) planar graph of the split ring edges. Half edges of a node
+// are stored contiguously and ordered clockwise(starting from the -X
+// direction), each half edge knows its twin, so faces can be walked without
+// any per node container.
+class PlanarGraph {
+ public:
+  struct HalfEdge {
+    size_t to;
+    size_t edge; // index of the source edge
+    size_t twin; // index of the opposite half edge
+  };
+
+  struct Range {
+    const HalfEdge *b, *e;
+    [[nodiscard]] const HalfEdge *begin() const { return b; }
+    [[nodiscard]] const HalfEdge *end() const { return e; }
+    [[nodiscard]] size_t size() const { return e - b; }
+    const HalfEdge &operator[](size_t i) const { return b[i]; }
+  };
+
+  using Edges = std::pmr::vector<std::optional<std::pair<size_t/*from*/, size_t/*to*/>>>;
+  using Face = std::pmr::vector<size_t>; // node ids
+  using Faces = std::pmr::vector<Face>;
+
+  // All the faces, bounded and unbounded
+  struct FaceWalk {
+    explicit FaceWalk(std::pmr::memory_resource *memory)
+        : halfEdges(memory), offsets(memory), faceOf(memory), doubleAreas(memory) {}
+
+    [[nodiscard]] size_t size() const { return doubleAreas.size(); }
+
+    std::pmr::vector<size_t> halfEdges;   // half edges grouped by faces, in the walk order
+    std::pmr::vector<size_t> offsets;     // face -> its first half edge in halfEdges, offsets[size()] == halfEdges.size()
+    std::pmr::vector<size_t> faceOf;      // half edge -> its face
+    std::pmr::vector<double> doubleAreas; // signed, positive - a bounded face
+  };
+
+  // nodes - node points, edges - node id pairs, std::nullopt - removed edge
+  PlanarGraph(const std::pmr::vector<Point> &nodes, const Edges &edges,
+              std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+
+  [[nodiscard]] size_t nodesCount() const { return offsets.size() - 1; }
+  [[nodiscard]] Range halfEdges(size_t node) const;
+  [[nodiscard]] const HalfEdge &halfEdge(size_t index) const { return edges_[index]; }
+  // Index of the first half edge of the node when they are ordered clockwise
+  // starting from the direction, which is included
+  [[nodiscard]] size_t clockwiseFrom(size_t node, Point direction) const;
+
+  // Boundaries of all the bounded faces. A face is walked keeping it on the
+  // left, so the faces are counter clockwise(in the Y up coordinate system).
+  [[nodiscard]] Faces faces(std::pmr::memory_resource *memory = std::pmr::get_default_resource()) const;
+  [[nodiscard]] FaceWalk walkFaces(std::pmr::memory_resource *memory = std::pmr::get_default_resource()) const;
+  // The node the half edge starts at
+  [[nodiscard]] size_t from(size_t halfEdge) const { return edges_[edges_[halfEdge].twin].to; }
+
+ private:
+  const std::pmr::vector<Point> &nodes;
+  std::pmr::vector<size_t> offsets; // node -> its first half edge, offsets[nodesCount()] == halfEdges count
+  std::pmr::vector<HalfEdge> edges_;
+};
+
+// Exact(no trigonometry, the filtered orient() predicate) angular comparison
+// of the given direction vectors: true if the clockwise angle from the
+// reference direction to l is less than to r. The reference direction itself
+// has the zero angle.
+bool clockwiseLess(Point reference, Point l, Point r);
+
+} // namespace ear_clip::details
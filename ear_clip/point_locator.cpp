@@ -0,0 +1,502 @@
+#include "point_locator.h"
+#include "point_welder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ear_clip {
+
+namespace {
+
+constexpr size_t NO_CELL = SIZE_MAX;
+constexpr double CELL_MARGIN = 1e-6; // of the cell size
+
+// The same expression as in details::pointInTriangle(), so both agree on the boundary points
+double signedArea(double ax, double ay, double bx, double by, double cx, double cy) {
+  return (cy - by) * (ax - cx) - (cx - bx) * (ay - cy);
+}
+
+double signedArea(Point a, Point b, Point c) {
+  return signedArea(a.x, a.y, b.x, b.y, c.x, c.y);
+}
+
+// The ends are on the different sides of the line(or on it)
+bool separated(double a, double b) {
+  return (a <= 0 && b >= 0) || (a >= 0 && b <= 0);
+}
+
+// The count of cells along a side, clamped before the cast: the ratio may be huge or NaN
+size_t gridSize(double cells, size_t max) {
+  return cells >= 1 ? static_cast<size_t>(std::min(cells, static_cast<double>(max))) : 1;
+}
+
+} // namespace
+
+PointLocator::PointLocator(const Triangles &triangles, std::pmr::memory_resource *memory)
+    : corners(memory), triangleIds(memory), neighbours(memory), vertices(memory), vertexOffsets(memory),
+      vertexTriangles(memory), seeds(memory), boundaryOffsets(memory), boundaryEdges(memory) {
+  details::PointWelder welder(0, memory);
+  corners.reserve(triangles.size());
+  triangleIds.reserve(triangles.size());
+  vertices.reserve(triangles.size());
+  double right = 0, top = 0;
+  for (size_t i = 0; i < triangles.size(); ++i) {
+    const auto &t = triangles[i];
+    auto area = signedArea(t[0], t[1], t[2]);
+    if (area == 0 || !std::isfinite(area))
+      continue;
+
+    corners.push_back({t[0].x, t[0].y, t[1].x, t[1].y, t[2].x, t[2].y});
+    triangleIds.push_back(static_cast<uint32_t>(i));
+    vertices.push_back({static_cast<uint32_t>(welder.weld(t[0])), static_cast<uint32_t>(welder.weld(t[1])),
+                        static_cast<uint32_t>(welder.weld(t[2]))});
+    if (corners.size() == 1) {
+      left = right = t[0].x;
+      bottom = top = t[0].y;
+    }
+    for (auto p : t) {
+      left = std::min(left, p.x);
+      right = std::max(right, p.x);
+      bottom = std::min(bottom, p.y);
+      top = std::max(top, p.y);
+    }
+  }
+  if (corners.empty())
+    return;
+  auto count = static_cast<uint32_t>(corners.size());
+
+  // About one cell per triangle, square cells
+  auto width = std::max(right - left, std::numeric_limits<double>::min());
+  auto height = std::max(top - bottom, std::numeric_limits<double>::min());
+  auto side = std::sqrt(width * height / static_cast<double>(count));
+  columns = gridSize(width / side, count);
+  rows = gridSize(height / side, count);
+  cellWidth = width / static_cast<double>(columns);
+  cellHeight = height / static_cast<double>(rows);
+
+  // The triangles around each vertex, in the index order
+  vertexOffsets.assign(welder.size() + 1, 0);
+  for (const auto &ids : vertices) {
+    for (auto v : ids)
+      ++vertexOffsets[v + 1];
+  }
+  for (size_t v = 1; v < vertexOffsets.size(); ++v)
+    vertexOffsets[v] += vertexOffsets[v - 1];
+  vertexTriangles.resize(vertexOffsets.back());
+  {
+    std::pmr::vector<uint32_t> filled(vertexOffsets.begin(), vertexOffsets.end() - 1, memory);
+    for (uint32_t t = 0; t < count; ++t) {
+      for (auto v : vertices[t])
+        vertexTriangles[filled[v]++] = t;
+    }
+  }
+
+  // The half-edges sorted by their edge: two half-edges of an edge link their
+  // triangles, an edge of more triangles stays the boundary for all of them
+  std::pmr::vector<std::pair<uint64_t, uint32_t>> halfEdges(memory);
+  halfEdges.reserve(3 * size_t{count});
+  for (uint32_t t = 0; t < count; ++t) {
+    for (uint32_t i = 0; i < 3; ++i) {
+      auto from = vertices[t][i], to = vertices[t][(i + 1) % 3];
+      halfEdges.emplace_back(uint64_t{std::min(from, to)} << 32 | std::max(from, to), 3 * t + i);
+    }
+  }
+  std::sort(halfEdges.begin(), halfEdges.end());
+  neighbours.assign(count, {NO_NEIGHBOUR, NO_NEIGHBOUR, NO_NEIGHBOUR});
+  for (size_t begin = 0, end = 0; begin < halfEdges.size(); begin = end) {
+    for (end = begin + 1; end < halfEdges.size() && halfEdges[end].first == halfEdges[begin].first; ++end) {
+    }
+    auto l = halfEdges[begin].second, r = halfEdges[begin + 1 < end ? begin + 1 : begin].second;
+    if (end - begin == 2 && l / 3 != r / 3) {
+      neighbours[l / 3][l % 3] = r / 3;
+      neighbours[r / 3][r % 3] = l / 3;
+    }
+  }
+
+  // The seed of a cell is the first triangle containing its center, the
+  // centers are found by the rows of the triangle. An empty cell(outside of
+  // the mesh) takes the seed of the closest(by the grid steps) seeded one.
+  seeds.assign(columns * rows, NO_NEIGHBOUR);
+  std::pmr::vector<size_t> queue(memory);
+  queue.reserve(seeds.size());
+  auto firstCenter = [](double from, double origin, double size, size_t count) {
+    auto i = std::ceil((from - origin) / size - 0.5);
+    return i > 0 ? static_cast<size_t>(std::min(i, static_cast<double>(count))) : 0;
+  };
+  for (uint32_t t = 0; t < count; ++t) {
+    auto v = points(t);
+    auto [low, high] = std::minmax({v[0].y, v[1].y, v[2].y});
+    for (auto r = firstCenter(low, bottom, cellHeight, rows); r < rows; ++r) {
+      auto y = bottom + (static_cast<double>(r) + 0.5) * cellHeight;
+      if (y > high)
+        break;
+      // the part of the center line in the triangle
+      auto from = std::numeric_limits<double>::infinity(), to = -from;
+      for (size_t i = 0; i < 3; ++i) {
+        auto a = v[i], b = v[(i + 1) % 3];
+        if (a.y == b.y) {
+          if (a.y == y) {
+            from = std::min({from, a.x, b.x});
+            to = std::max({to, a.x, b.x});
+          }
+        } else if ((a.y <= y && y <= b.y) || (b.y <= y && y <= a.y)) {
+          auto x = a.x + (y - a.y) / (b.y - a.y) * (b.x - a.x);
+          from = std::min(from, x);
+          to = std::max(to, x);
+        }
+      }
+      for (auto c = firstCenter(from, left, cellWidth, columns); c < columns; ++c) {
+        if (left + (static_cast<double>(c) + 0.5) * cellWidth > to)
+          break;
+        if (seeds[r * columns + c] == NO_NEIGHBOUR) {
+          seeds[r * columns + c] = t;
+          queue.push_back(r * columns + c);
+        }
+      }
+    }
+  }
+  // a cell without a center inside a triangle starts from the triangle of its centroid
+  for (uint32_t t = 0; t < count; ++t) {
+    auto v = points(t);
+    auto c = cell({(v[0].x + v[1].x + v[2].x) / 3, (v[0].y + v[1].y + v[2].y) / 3});
+    if (c != NO_CELL && seeds[c] == NO_NEIGHBOUR) {
+      seeds[c] = t;
+      queue.push_back(c);
+    }
+  }
+  for (size_t i = 0; i < queue.size(); ++i) {
+    auto c = queue[i] % columns, r = queue[i] / columns;
+    auto spread = [&](size_t to) {
+      if (seeds[to] == NO_NEIGHBOUR) {
+        seeds[to] = seeds[queue[i]];
+        queue.push_back(to);
+      }
+    };
+    if (c > 0)
+      spread(queue[i] - 1);
+    if (c + 1 < columns)
+      spread(queue[i] + 1);
+    if (r > 0)
+      spread(queue[i] - columns);
+    if (r + 1 < rows)
+      spread(queue[i] + columns);
+  }
+
+  // The boundary edges by the cells they pass
+  auto forEachBoundaryEdge = [&](auto &&f) {
+    for (uint32_t t = 0; t < count; ++t) {
+      const auto &c = corners[t];
+      Point v[3] = {{c.x0, c.y0}, {c.x1, c.y1}, {c.x2, c.y2}};
+      for (uint32_t i = 0; i < 3; ++i) {
+        if (neighbours[t][i] == NO_NEIGHBOUR)
+          forEachCell(v[i], v[(i + 1) % 3], [&](size_t cell) { f(cell, 3 * t + i); });
+      }
+    }
+  };
+  boundaryOffsets.assign(columns * rows + 1, 0);
+  forEachBoundaryEdge([&](size_t cell, uint32_t) { ++boundaryOffsets[cell + 1]; });
+  for (size_t i = 1; i < boundaryOffsets.size(); ++i)
+    boundaryOffsets[i] += boundaryOffsets[i - 1];
+  boundaryEdges.resize(boundaryOffsets.back());
+  std::pmr::vector<uint32_t> filled(boundaryOffsets.begin(), boundaryOffsets.end() - 1, memory);
+  forEachBoundaryEdge([&](size_t cell, uint32_t edge) { boundaryEdges[filled[cell]++] = edge; });
+
+  // The overlapping triangles(e.g. the legacy output of a self intersecting
+  // ring) have the neighbours folded over their edge or the crossing boundary
+  // edges. The walk can't prove a point is outside then, so they are scanned.
+  for (uint32_t t = 0; t < count && !overlapping; ++t) {
+    auto v = points(t);
+    for (uint32_t i = 0; i < 3; ++i) {
+      auto n = neighbours[t][i];
+      if (n == NO_NEIGHBOUR || n < t)
+        continue;
+      uint32_t j = 0;
+      while (neighbours[n][j] != t)
+        ++j;
+      auto a = v[i], b = v[(i + 1) % 3];
+      overlapping |= signedArea(a, b, v[(i + 2) % 3]) * signedArea(a, b, points(n)[(j + 2) % 3]) > 0;
+    }
+  }
+  for (size_t c = 0; c < columns * rows && !overlapping; ++c) {
+    for (auto k = boundaryOffsets[c]; k < boundaryOffsets[c + 1] && !overlapping; ++k) {
+      auto v = points(boundaryEdges[k] / 3);
+      auto i = boundaryEdges[k] % 3;
+      for (auto l = k + 1; l < boundaryOffsets[c + 1] && !overlapping; ++l) {
+        auto w = points(boundaryEdges[l] / 3);
+        auto j = boundaryEdges[l] % 3;
+        overlapping = details::intersects(v[i], v[(i + 1) % 3], w[j], w[(j + 1) % 3]);
+      }
+    }
+  }
+}
+
+size_t PointLocator::cell(Point p) const {
+  auto x = (p.x - left) / cellWidth;
+  auto y = (p.y - bottom) / cellHeight;
+  // a point on the far border belongs to the last cell
+  if (!(x >= 0 && y >= 0 && x <= static_cast<double>(columns) && y <= static_cast<double>(rows)))
+    return NO_CELL;
+
+  return std::min(rows - 1, static_cast<size_t>(y)) * columns + std::min(columns - 1, static_cast<size_t>(x));
+}
+
+size_t PointLocator::column(double x) const {
+  auto c = (x - left) / cellWidth;
+  return c >= 0 ? static_cast<size_t>(std::min(c, static_cast<double>(columns - 1))) : 0;
+}
+
+size_t PointLocator::row(double y) const {
+  auto r = (y - bottom) / cellHeight;
+  return r >= 0 ? static_cast<size_t>(std::min(r, static_cast<double>(rows - 1))) : 0;
+}
+
+// A column at a time: the cells under the part of the segment over the
+// column, slightly grown, so the rounding of the point to cell mapping
+// doesn't matter
+template <class F>
+void PointLocator::forEachCell(Point a, Point b, F &&f) const {
+  auto y = [&](double x) {
+    auto u = a.x == b.x ? 0.0 : std::clamp((x - a.x) / (b.x - a.x), 0.0, 1.0);
+    return a.y + u * (b.y - a.y);
+  };
+  for (auto c = column(std::min(a.x, b.x)), c1 = column(std::max(a.x, b.x)); c <= c1; ++c) {
+    double y0 = a.y, y1 = b.y;
+    if (a.x != b.x) {
+      y0 = y(left + (static_cast<double>(c) - CELL_MARGIN) * cellWidth);
+      y1 = y(left + (static_cast<double>(c) + 1 + CELL_MARGIN) * cellWidth);
+    }
+    auto margin = CELL_MARGIN * cellHeight;
+    for (auto r = row(std::min(y0, y1) - margin), r1 = row(std::max(y0, y1) + margin); r <= r1; ++r)
+      f(r * columns + c);
+  }
+}
+
+std::array<Point, 3> PointLocator::points(uint32_t t) const {
+  const auto &c = corners[t];
+  return {Point{c.x0, c.y0}, Point{c.x1, c.y1}, Point{c.x2, c.y2}};
+}
+
+bool PointLocator::contains(uint32_t t, Point p) const {
+  const auto &c = corners[t];
+  // the bbox first: the rounded areas of a sliver put its whole line in it
+  if (p.x < std::min({c.x0, c.x1, c.x2}) || p.x > std::max({c.x0, c.x1, c.x2}) ||
+      p.y < std::min({c.y0, c.y1, c.y2}) || p.y > std::max({c.y0, c.y1, c.y2}))
+    return false;
+  auto d1 = signedArea(p.x, p.y, c.x0, c.y0, c.x1, c.y1);
+  auto d2 = signedArea(p.x, p.y, c.x1, c.y1, c.x2, c.y2);
+  auto d3 = signedArea(p.x, p.y, c.x2, c.y2, c.x0, c.y0);
+  return std::min({d1, d2, d3}) >= 0 || std::max({d1, d2, d3}) <= 0;
+}
+
+uint32_t PointLocator::walk(uint32_t t, Point s, Point p) const {
+  // The line parameter of the point on it
+  auto along = [&](Point v) {
+    auto dx = p.x - s.x, dy = p.y - s.y;
+    return ((v.x - s.x) * dx + (v.y - s.y) * dy) / (dx * dx + dy * dy);
+  };
+
+  // The line crosses a triangle once, so a longer walk is a loop(the rounding
+  // of the degenerate cases), the scan answers then
+  for (size_t steps = 0; steps <= corners.size(); ++steps) {
+    if (contains(t, p))
+      return t;
+
+    // The edge the line leaves through: p is outside of it and the line
+    // separates its ends
+    auto v = points(t);
+    auto sign = signedArea(v[0], v[1], v[2]) > 0 ? 1.0 : -1.0;
+    double sides[3] = {signedArea(s, p, v[0]), signedArea(s, p, v[1]), signedArea(s, p, v[2])};
+    size_t exit = 3;
+    bool crossed = false;
+    for (size_t i = 0; i < 3; ++i) {
+      if (sign * signedArea(p, v[i], v[(i + 1) % 3]) >= 0)
+        continue;
+      auto separates = separated(sides[i], sides[(i + 1) % 3]);
+      if (exit == 3 || (separates && !crossed)) {
+        exit = i;
+        crossed = separates;
+      }
+    }
+    if (exit == 3)
+      return scan(p); // the rounding: p is outside of no edge, but not inside either
+    auto a = exit, b = (exit + 1) % 3;
+
+    if (!crossed || (sides[a] != 0 && sides[b] != 0)) {
+      if (neighbours[t][exit] != NO_NEIGHBOUR) {
+        t = neighbours[t][exit];
+        continue;
+      }
+      // The line leaves the mesh through the edge
+      auto from = signedArea(s, v[a], v[b]), to = signedArea(p, v[a], v[b]);
+      t = reenter(t, s, p, from == to ? 0.0 : std::clamp(from / (from - to), 0.0, 1.0));
+      if (t == NO_NEIGHBOUR)
+        return NO_NEIGHBOUR;
+      continue;
+    }
+
+    // The line passes the vertex: it goes on into a triangle around it, along
+    // an edge to its other end or out of the mesh
+    auto vertex = vertices[t][sides[a] == 0 && (sides[b] != 0 || along(v[a]) > along(v[b])) ? a : b];
+    auto next = NO_NEIGHBOUR;
+    while (next == NO_NEIGHBOUR && steps++ <= corners.size()) {
+      auto passed = vertex;
+      for (auto k = vertexOffsets[vertex]; k < vertexOffsets[vertex + 1] && next == NO_NEIGHBOUR; ++k) {
+        auto around = vertexTriangles[k];
+        if (contains(around, p))
+          return around;
+        auto w = points(around);
+        size_t j = 0;
+        while (vertices[around][j] != vertex)
+          ++j;
+        auto origin = w[j], first = w[(j + 1) % 3], second = w[(j + 2) % 3];
+        auto inside = signedArea(w[0], w[1], w[2]) > 0 ? 1.0 : -1.0;
+        auto toFirst = inside * signedArea(p, origin, first), toSecond = inside * signedArea(p, second, origin);
+        if (toFirst > 0 && toSecond > 0)
+          next = around;
+        else if (toFirst == 0 && along(first) > along(origin))
+          passed = vertices[around][(j + 1) % 3];
+        else if (toSecond == 0 && along(second) > along(origin))
+          passed = vertices[around][(j + 2) % 3];
+      }
+      if (next != NO_NEIGHBOUR || passed == vertex) {
+        if (next == NO_NEIGHBOUR) {
+          // Out of the mesh at the vertex
+          auto first = vertexTriangles[vertexOffsets[vertex]];
+          size_t j = 0;
+          while (vertices[first][j] != vertex)
+            ++j;
+          auto at = points(first)[j];
+          next = reenter(NO_NEIGHBOUR, s, p, along(at));
+          if (next == NO_NEIGHBOUR)
+            return NO_NEIGHBOUR;
+        }
+        break;
+      }
+      vertex = passed;
+    }
+    if (next == NO_NEIGHBOUR)
+      break;
+    t = next;
+  }
+
+  return scan(p);
+}
+
+uint32_t PointLocator::reenter(uint32_t t, Point s, Point p, double u) const {
+  Point from{s.x + u * (p.x - s.x), s.y + u * (p.y - s.y)};
+  auto result = NO_NEIGHBOUR;
+  auto resultU = std::numeric_limits<double>::infinity();
+  forEachCell(from, p, [&](size_t cell) {
+    for (auto k = boundaryOffsets[cell]; k < boundaryOffsets[cell + 1]; ++k) {
+      auto other = boundaryEdges[k] / 3, i = boundaryEdges[k] % 3;
+      if (other == t)
+        continue; // a line crosses a triangle once
+      auto w = points(other);
+      auto a = w[i], b = w[(i + 1) % 3];
+      auto inside = signedArea(w[0], w[1], w[2]) > 0 ? 1.0 : -1.0;
+      auto before = inside * signedArea(s, a, b), after = inside * signedArea(p, a, b);
+      if (!(before < 0 && after >= 0) || !separated(signedArea(s, p, a), signedArea(s, p, b)))
+        continue;
+      auto entry = before / (before - after);
+      // the same point may be computed a bit differently for another edge
+      if (entry >= u - 1e-9 && entry < resultU) {
+        result = other;
+        resultU = entry;
+      }
+    }
+  });
+  return result;
+}
+
+uint32_t PointLocator::onBoundary(Point p) const {
+  auto result = NO_NEIGHBOUR;
+  auto c = cell(p);
+  for (auto k = boundaryOffsets[c]; k < boundaryOffsets[c + 1]; ++k) {
+    auto t = boundaryEdges[k] / 3;
+    if (triangleIds[t] < (result == NO_NEIGHBOUR ? SIZE_MAX : triangleIds[result]) && contains(t, p))
+      result = t;
+  }
+  return result;
+}
+
+uint32_t PointLocator::scan(Point p) const {
+  for (uint32_t t = 0; t < corners.size(); ++t) {
+    if (contains(t, p))
+      return t;
+  }
+  return NO_NEIGHBOUR;
+}
+
+size_t PointLocator::lowestContaining(uint32_t t, Point p) const {
+  size_t result = triangleIds[t];
+  auto consider = [&](uint32_t other) {
+    if (triangleIds[other] < result && contains(other, p))
+      result = triangleIds[other];
+  };
+  for (auto n : neighbours[t]) {
+    if (n != NO_NEIGHBOUR)
+      consider(n);
+  }
+  // the triangles around a vertex are in the index order
+  auto v = points(t);
+  for (size_t i = 0; i < 3; ++i) {
+    if (p == v[i])
+      consider(vertexTriangles[vertexOffsets[vertices[t][i]]]);
+  }
+  // A point on the boundary of t may be on a boundary edge of another
+  // triangle too(a vertex on the edge of the other side is unlinked)
+  if (signedArea(p, v[0], v[1]) == 0 || signedArea(p, v[1], v[2]) == 0 || signedArea(p, v[2], v[0]) == 0) {
+    auto other = onBoundary(p);
+    if (other != NO_NEIGHBOUR)
+      consider(other);
+  }
+  return result;
+}
+
+size_t PointLocator::locate(Point p) const {
+  size_t result;
+  locate(&p, 1, &result);
+  return result;
+}
+
+void PointLocator::locate(const Point *points, size_t count, size_t *result) const {
+  if (corners.empty()) {
+    std::fill(result, result + count, NO_TRIANGLE);
+    return;
+  }
+
+  size_t previousCell = NO_CELL;
+  auto previous = NO_NEIGHBOUR;
+  for (size_t i = 0; i < count; ++i) {
+    auto p = points[i];
+    auto c = cell(p);
+    if (c == NO_CELL) {
+      result[i] = NO_TRIANGLE;
+      continue;
+    }
+    if (overlapping) {
+      auto t = scan(p);
+      result[i] = t == NO_NEIGHBOUR ? NO_TRIANGLE : triangleIds[t];
+      continue;
+    }
+    // from the cell center if the seed has it, otherwise(the cell is out of
+    // the mesh or the previous point is coherent) from the triangle centroid
+    auto start = c == previousCell && previous != NO_NEIGHBOUR ? previous : seeds[c];
+    Point s{left + (static_cast<double>(c % columns) + 0.5) * cellWidth,
+            bottom + (static_cast<double>(c / columns) + 0.5) * cellHeight};
+    if (start == previous || !contains(start, s)) {
+      auto v = this->points(start);
+      s = {(v[0].x + v[1].x + v[2].x) / 3, (v[0].y + v[1].y + v[2].y) / 3};
+    }
+    auto t = walk(start, s, p);
+    // the rounding may turn the walk away along a sliver, the point is near the boundary then
+    if (t == NO_NEIGHBOUR)
+      t = onBoundary(p);
+    result[i] = t == NO_NEIGHBOUR ? NO_TRIANGLE : lowestContaining(t, p);
+    previousCell = c;
+    previous = t;
+  }
+}
+
+} // namespace ear_clip
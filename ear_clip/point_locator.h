@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ear_clip.h"
+
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace ear_clip {
+
+// Answers "which triangle contains the point" over the triangulate() output.
+// The triangles are linked across their common edges(the vertices are welded
+// exactly), and a coarse grid of about one cell per triangle keeps the
+// triangle containing the cell center. A query walks from the center of the
+// point cell along the straight line to the point, crossing the triangles
+// between them(around a vertex if the line passes it). If the line leaves the
+// mesh(a concave part or a hole), the walk goes on from the first boundary
+// edge it enters again, the boundary edges are bucketed into the same grid.
+//
+// The build is O(n log n) plus the grid rows the triangles span. A query
+// costs the triangles the walk crosses: O(1) for the triangles of about the
+// cell size, more for the thin ones, e.g. about sqrt(n) for the fan of a
+// convex ring.
+//
+// A triangle contains its boundary. A point on the common edge or vertex of
+// several triangles is reported for the first of them(the lowest index), as a
+// linear scan would do it. Zero area triangles are never reported. The
+// overlapping triangles(the legacy output of a self intersecting ring may
+// have them) are found by the build, the queries scan all of the triangles
+// then.
+class PointLocator {
+ public:
+  static constexpr size_t NO_TRIANGLE = SIZE_MAX;
+
+  explicit PointLocator(const Triangles &triangles,
+                        std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+
+  // Index of the triangle containing the point(boundary included) or NO_TRIANGLE
+  [[nodiscard]] size_t locate(Point p) const;
+  // result[i] - locate(points[i]). A point walks from the triangle of the
+  // previous one if they share the cell, so the coherent points(e.g. a
+  // raster scan) are cheaper.
+  void locate(const Point *points, size_t count, size_t *result) const;
+
+ private:
+  struct Corners {
+    double x0, y0, x1, y1, x2, y2;
+  };
+  static constexpr uint32_t NO_NEIGHBOUR = UINT32_MAX;
+
+  [[nodiscard]] size_t cell(Point p) const;
+  [[nodiscard]] size_t column(double x) const;
+  [[nodiscard]] size_t row(double y) const;
+  // Calls f(cell) for the cells the segment may pass
+  template <class F>
+  void forEachCell(Point a, Point b, F &&f) const;
+
+  [[nodiscard]] std::array<Point, 3> points(uint32_t t) const;
+  [[nodiscard]] bool contains(uint32_t t, Point p) const;
+  // The triangle containing p, walking from t along the line from s(inside t) or NO_NEIGHBOUR
+  [[nodiscard]] uint32_t walk(uint32_t t, Point s, Point p) const;
+  // The triangle the line s-p enters through a boundary edge after the
+  // parameter u(of the line, s - 0, p - 1), except t, or NO_NEIGHBOUR
+  [[nodiscard]] uint32_t reenter(uint32_t t, Point s, Point p, double u) const;
+  // The lowest index triangle with a boundary edge in the cell of p containing p or NO_NEIGHBOUR
+  [[nodiscard]] uint32_t onBoundary(Point p) const;
+  [[nodiscard]] uint32_t scan(Point p) const;
+  // The lowest index of the triangles containing p, t is one of them
+  [[nodiscard]] size_t lowestContaining(uint32_t t, Point p) const;
+
+  double left = 0, bottom = 0;
+  double cellWidth = 1, cellHeight = 1;
+  size_t columns = 0, rows = 0;
+  bool overlapping = false; // the queries scan
+  std::pmr::vector<Corners> corners;
+  std::pmr::vector<uint32_t> triangleIds; // index of corners -> triangle index
+  // The triangle across the edge i - i + 1 or NO_NEIGHBOUR for the boundary
+  std::pmr::vector<std::array<uint32_t, 3>> neighbours;
+  std::pmr::vector<std::array<uint32_t, 3>> vertices; // the welded vertex ids
+  std::pmr::vector<uint32_t> vertexOffsets;           // vertex -> its first triangle, CSR
+  std::pmr::vector<uint32_t> vertexTriangles;         // corners indices, ascending
+  std::pmr::vector<uint32_t> seeds;                   // cell -> the triangle the walk starts from
+  std::pmr::vector<uint32_t> boundaryOffsets;         // cell -> its first boundary edge, CSR
+  std::pmr::vector<uint32_t> boundaryEdges;           // 3 * corners index + edge
+};
+
+} // namespace ear_clip
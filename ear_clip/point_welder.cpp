@@ -0,0 +1,139 @@
+#include "point_welder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace ear_clip::details {
+
+namespace {
+
+uint64_t mix(uint64_t h) { // splitmix64 finalizer
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+uint64_t bits(double v) {
+  if (v == 0)
+    v = 0; // -0.0 == 0.0, so they must have the same hash
+  uint64_t result;
+  std::memcpy(&result, &v, sizeof(result));
+  return result;
+}
+
+uint64_t hash(uint64_t x, uint64_t y) {
+  return mix(x ^ mix(y + 0x9e3779b97f4a7c15ULL));
+}
+
+int64_t cellIndex(double v, double tolerance) {
+  constexpr double LIMIT = 4e18; // fits int64_t
+  return static_cast<int64_t>(std::clamp(std::floor(v / tolerance), -LIMIT, LIMIT));
+}
+
+constexpr size_t MIN_CAPACITY = 16;
+
+} // namespace
+
+PointWelder::PointWelder(double tolerance, std::pmr::memory_resource *memory)
+    : tolerance_(tolerance), points_(memory), slots(memory) {
+  if (!(tolerance >= 0))
+    raise<std::invalid_argument>("Negative weld tolerance");
+}
+
+void PointWelder::reserve(size_t count) {
+  points_.reserve(count);
+  size_t capacity = slots.empty() ? MIN_CAPACITY : slots.size();
+  while (capacity < count * 2)
+    capacity *= 2;
+  if (capacity != slots.size())
+    rehash(capacity);
+}
+
+size_t PointWelder::weld(Point p) {
+  if (auto id = find(p); id != NO_ID)
+    return id;
+
+  if ((points_.size() + 1) * 2 > slots.size())
+    rehash(std::max(MIN_CAPACITY, slots.size() * 2));
+
+  auto id = points_.size();
+  points_.push_back(p);
+  insert(id);
+  return id;
+}
+
+size_t PointWelder::find(Point p) const {
+  if (slots.empty())
+    return NO_ID;
+
+  if (tolerance_ == 0)
+    return findExact(p);
+
+  // The nearest cells can contain points which are closer than the tolerance.
+  // Each cell has one point at most, because the cell size is the tolerance.
+  auto [cx, cy] = cell(p);
+  size_t result = NO_ID;
+  for (int64_t dx = -1; dx <= 1; ++dx) {
+    for (int64_t dy = -1; dy <= 1; ++dy) {
+      auto id = findInCell({cx + dx, cy + dy});
+      if (id == NO_ID || id > result)
+        continue;
+      auto q = points_[id];
+      if (std::abs(q.x - p.x) <= tolerance_ && std::abs(q.y - p.y) <= tolerance_)
+        result = id; // the first welded point wins
+    }
+  }
+
+  return result;
+}
+
+PointWelder::Cell PointWelder::cell(Point p) const {
+  return {cellIndex(p.x, tolerance_), cellIndex(p.y, tolerance_)};
+}
+
+size_t PointWelder::findExact(Point p) const {
+  auto mask = slots.size() - 1;
+  for (auto i = hash(bits(p.x), bits(p.y)) & mask;; i = (i + 1) & mask) {
+    auto id = slots[i];
+    if (id == NO_ID || points_[id] == p)
+      return id;
+  }
+}
+
+size_t PointWelder::findInCell(Cell c) const {
+  auto mask = slots.size() - 1;
+  for (auto i = hash(c.first, c.second) & mask;; i = (i + 1) & mask) {
+    auto id = slots[i];
+    if (id == NO_ID || cell(points_[id]) == c)
+      return id;
+  }
+}
+
+size_t PointWelder::slotHash(Point p) const {
+  if (tolerance_ == 0)
+    return hash(bits(p.x), bits(p.y));
+
+  auto [x, y] = cell(p);
+  return hash(x, y);
+}
+
+void PointWelder::insert(size_t id) {
+  auto mask = slots.size() - 1;
+  auto i = slotHash(points_[id]) & mask;
+  while (slots[i] != NO_ID)
+    i = (i + 1) & mask;
+  slots[i] = id;
+}
+
+void PointWelder::rehash(size_t capacity) {
+  slots.assign(capacity, NO_ID);
+  for (size_t id = 0; id < points_.size(); ++id)
+    insert(id);
+}
+
+} // namespace ear_clip::details
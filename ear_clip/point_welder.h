@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ear_clip.h"
+
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+namespace ear_clip::details {
+
+// Gives dense ids(0, 1, 2...) to distinct points in the order they are met.
+// It's a flat open addressing hash table, so a lookup is O(1) and there is no
+// allocation per point.
+//
+// With a non zero tolerance points which differ by no more than the tolerance
+// in both coordinates are welded: they get the id(and coordinates) of the
+// first of them. Such points are looked for in the neighbouring cells of the
+// tolerance sized grid.
+class PointWelder {
+ public:
+  static constexpr size_t NO_ID = SIZE_MAX;
+
+  explicit PointWelder(double tolerance = 0,
+                       std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+
+  void reserve(size_t count);
+
+  // Returns the id of the point, adds the point if it's new
+  size_t weld(Point p);
+  // Returns the id of the point or NO_ID
+  [[nodiscard]] size_t find(Point p) const;
+
+  // Representative points, an index in the vector is the point id
+  [[nodiscard]] const std::pmr::vector<Point> &points() const { return points_; }
+  [[nodiscard]] size_t size() const { return points_.size(); }
+  [[nodiscard]] double tolerance() const { return tolerance_; }
+
+ private:
+  using Cell = std::pair<int64_t, int64_t>;
+
+  [[nodiscard]] Cell cell(Point p) const;
+  [[nodiscard]] size_t findExact(Point p) const;
+  [[nodiscard]] size_t findInCell(Cell c) const;
+  [[nodiscard]] size_t slotHash(Point p) const;
+  void insert(size_t id);
+  void rehash(size_t capacity);
+
+  double tolerance_;
+  std::pmr::vector<Point> points_;
+  std::pmr::vector<size_t> slots; // point ids, NO_ID - empty slot. The size is a power of 2
+};
+
+} // namespace ear_clip::details
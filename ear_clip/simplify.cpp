@@ -0,0 +1,167 @@
+#include "simplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <vector>
+
+namespace ear_clip {
+
+namespace {
+
+// Uniform grid of the ring vertices, about one vertex per cell
+class VertexGrid {
+ public:
+  VertexGrid(const std::pmr::vector<Point> &points, std::pmr::memory_resource *memory)
+      : offsets(memory), entries(memory) {
+    left = bottom = std::numeric_limits<double>::max();
+    double right = std::numeric_limits<double>::lowest(), top = right;
+    for (const auto &p : points) {
+      left = std::min(left, p.x);
+      right = std::max(right, p.x);
+      bottom = std::min(bottom, p.y);
+      top = std::max(top, p.y);
+    }
+    auto side = std::max(std::sqrt((right - left) * (top - bottom) / static_cast<double>(points.size())),
+                         std::numeric_limits<double>::min());
+    columns = std::clamp<size_t>(static_cast<size_t>((right - left) / side), 1, points.size());
+    rows = std::clamp<size_t>(static_cast<size_t>((top - bottom) / side), 1, points.size());
+    cellWidth = std::max((right - left) / static_cast<double>(columns), std::numeric_limits<double>::min());
+    cellHeight = std::max((top - bottom) / static_cast<double>(rows), std::numeric_limits<double>::min());
+
+    offsets.assign(columns * rows + 1, 0);
+    for (const auto &p : points)
+      offsets[cell(column(p.x), row(p.y)) + 1]++;
+    for (size_t c = 0; c + 1 < offsets.size(); ++c)
+      offsets[c + 1] += offsets[c];
+    entries.resize(points.size());
+    std::pmr::vector<size_t> cursor(offsets.begin(), offsets.end() - 1, memory);
+    for (size_t i = 0; i < points.size(); ++i)
+      entries[cursor[cell(column(points[i].x), row(points[i].y))]++] = i;
+  }
+
+  // Calls f(vertex) for the vertices of the cells overlapping the rect, until it returns true
+  template <class F>
+  bool any(Point min, Point max, F &&f) const {
+    auto c1 = column(max.x), r1 = row(max.y);
+    for (auto r = row(min.y); r <= r1; ++r) {
+      for (auto c = column(min.x); c <= c1; ++c) {
+        auto index = cell(c, r);
+        for (auto i = offsets[index]; i < offsets[index + 1]; ++i) {
+          if (f(entries[i]))
+            return true;
+        }
+      }
+    }
+    return false;
+  }
+
+ private:
+  [[nodiscard]] size_t column(double x) const {
+    return std::min(columns - 1, static_cast<size_t>(std::max(0.0, (x - left) / cellWidth)));
+  }
+  [[nodiscard]] size_t row(double y) const {
+    return std::min(rows - 1, static_cast<size_t>(std::max(0.0, (y - bottom) / cellHeight)));
+  }
+  [[nodiscard]] size_t cell(size_t c, size_t r) const { return r * columns + c; }
+
+  double left, bottom, cellWidth, cellHeight;
+  size_t columns, rows;
+  std::pmr::vector<size_t> offsets, entries; // CSR: vertices per cell
+};
+
+double cross(Point o, Point a, Point b) {
+  return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+// Distance from the point to the segment
+double distance(Point p, Point a, Point b) {
+  auto dx = b.x - a.x, dy = b.y - a.y;
+  auto length2 = dx * dx + dy * dy;
+  auto t = length2 == 0 ? 0 : std::clamp(((p.x - a.x) * dx + (p.y - a.y) * dy) / length2, 0.0, 1.0);
+  return std::hypot(p.x - (a.x + t * dx), p.y - (a.y + t * dy));
+}
+
+// The closed triangle contains the point(any orientation, a zero area one - its segments)
+bool inTriangle(Point p, Point a, Point b, Point c) {
+  auto d0 = cross(a, b, p), d1 = cross(b, c, p), d2 = cross(c, a, p);
+  bool negative = d0 < 0 || d1 < 0 || d2 < 0;
+  bool positive = d0 > 0 || d1 > 0 || d2 > 0;
+  if (negative && positive)
+    return false;
+  if (negative || positive)
+    return true;
+  // Collinear: within the bbox of the triangle
+  return p.x >= std::min({a.x, b.x, c.x}) && p.x <= std::max({a.x, b.x, c.x}) &&
+      p.y >= std::min({a.y, b.y, c.y}) && p.y <= std::max({a.y, b.y, c.y});
+}
+
+} // namespace
+
+Ring simplify(Ring ring, double tolerance, std::pmr::memory_resource *memory) {
+  if (ring.size() <= 3)
+    return Ring(ring.begin(), ring.end(), memory);
+
+  std::pmr::vector<Point> points(ring.begin(), ring.end(), memory);
+  auto size = points.size();
+  std::pmr::vector<size_t> prev(size, memory), next(size, memory), version(size, 0, memory);
+  std::pmr::vector<bool> removed(size, false, memory);
+  for (size_t i = 0; i < size; ++i) {
+    prev[i] = i == 0 ? size - 1 : i - 1;
+    next[i] = i + 1 == size ? 0 : i + 1;
+  }
+  VertexGrid grid(points, memory);
+
+  // The closest to the neighbours segment first, stale entries have an old version
+  struct Candidate {
+    double distance;
+    size_t vertex, version;
+    bool operator<(const Candidate &other) const { return distance > other.distance; }
+  };
+  std::priority_queue<Candidate, std::pmr::vector<Candidate>> queue{std::less<Candidate>(),
+                                                                    std::pmr::vector<Candidate>(memory)};
+  auto push = [&](size_t v) {
+    auto d = distance(points[v], points[prev[v]], points[next[v]]);
+    if (d <= tolerance)
+      queue.push({d, v, version[v]});
+  };
+  for (size_t i = 0; i < size; ++i)
+    push(i);
+
+  auto left = size;
+  while (!queue.empty() && left > 3) {
+    auto candidate = queue.top();
+    queue.pop();
+    auto v = candidate.vertex;
+    if (removed[v] || candidate.version != version[v])
+      continue;
+
+    auto a = points[prev[v]], b = points[v], c = points[next[v]];
+    Point min{std::min({a.x, b.x, c.x}), std::min({a.y, b.y, c.y})};
+    Point max{std::max({a.x, b.x, c.x}), std::max({a.y, b.y, c.y})};
+    bool blocked = grid.any(min, max, [&](size_t other) {
+      return !removed[other] && other != v && other != prev[v] && other != next[v] && inTriangle(points[other], a, b, c);
+    });
+    if (blocked)
+      continue;
+
+    removed[v] = true;
+    left--;
+    next[prev[v]] = next[v];
+    prev[next[v]] = prev[v];
+    for (auto neighbour : {prev[v], next[v]}) {
+      version[neighbour]++;
+      push(neighbour);
+    }
+  }
+
+  Ring result(memory);
+  for (size_t i = 0; i < size; ++i) {
+    if (!removed[i])
+      result.push_back(points[i]);
+  }
+  return result;
+}
+
+} // namespace ear_clip
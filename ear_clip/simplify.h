@@ -0,0 +1,26 @@
+#pragma once
+
+#include "ear_clip.h"
+
+#include <memory_resource>
+
+namespace ear_clip {
+
+// Removes the vertices which are closer than the tolerance to the segment
+// of their neighbours(Visvalingam style: the closest ones go first, the
+// neighbours are reevaluated after each removal), 0 - only the collinear
+// vertices. At least 3 vertices are left.
+//
+// A vertex isn't removed if its triangle with the neighbours contains any
+// other vertex(the boundary included). For a simple ring it keeps the
+// topology: an edge can't enter the triangle without a vertex inside, so the
+// new edge can't cross the ring and no self intersection is introduced. A
+// self intersecting ring gets no such guarantee, an edge crossing both sides
+// of the triangle isn't detected.
+//
+// O(n log n) for the evenly spread vertices. Each removal test scans the
+// vertex grid cells under the triangle bbox, so the long edges over many
+// cells make it up to O(n^2).
+Ring simplify(Ring ring, double tolerance, std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+
+} // namespace ear_clip
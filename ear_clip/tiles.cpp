@@ -0,0 +1,282 @@
+#include "tiles.h"
+#include "memory_resources.h"
+#include "point_welder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory_resource>
+#include <thread>
+
+namespace ear_clip {
+
+namespace {
+
+// Smaller outputs aren't worth starting threads for(if their count isn't set explicitly)
+constexpr size_t PARALLEL_MIN_TRIANGLES = 4096;
+
+// A triangle cut by the 4 tile borders, each of them adds a vertex at most
+struct Piece {
+  std::array<Point, 8> points;
+  size_t size = 0;
+};
+
+// The point of the segment on the border. It's computed from the ordered
+// ends, so the tiles on both sides of the border get the same one.
+Point atX(Point a, Point b, double x) {
+  if (a.x == x)
+    return a;
+  if (b.x == x)
+    return b;
+  if (b < a)
+    std::swap(a, b);
+  return {x, a.y + (x - a.x) / (b.x - a.x) * (b.y - a.y)};
+}
+
+Point atY(Point a, Point b, double y) {
+  if (a.y == y)
+    return a;
+  if (b.y == y)
+    return b;
+  if (b < a)
+    std::swap(a, b);
+  return {a.x + (y - a.y) / (b.y - a.y) * (b.x - a.x), y};
+}
+
+// Keeps the part of the convex piece where inside(p), the border points included
+template <class Inside, class Cross>
+void clip(Piece &piece, Inside inside, Cross cross) {
+  Piece result;
+  for (size_t i = 0; i < piece.size; ++i) {
+    auto a = piece.points[i], b = piece.points[(i + 1) % piece.size];
+    bool aInside = inside(a), bInside = inside(b);
+    if (aInside)
+      result.points[result.size++] = a;
+    if (aInside != bInside)
+      result.points[result.size++] = cross(a, b);
+  }
+  piece = result;
+}
+
+// The tiles a triangle overlaps, empty if first > last
+struct TileRange {
+  size_t firstColumn, lastColumn, firstRow, lastRow;
+};
+
+class Tiling {
+ public:
+  explicit Tiling(const TileGrid &grid) : grid(grid) {}
+
+  // The borders are computed the same way for both of their tiles
+  [[nodiscard]] double columnX(size_t column) const {
+    return grid.origin.x + static_cast<double>(column) * grid.tileWidth;
+  }
+  [[nodiscard]] double rowY(size_t row) const {
+    return grid.origin.y + static_cast<double>(row) * grid.tileHeight;
+  }
+
+  [[nodiscard]] TileRange range(const Triangle &t) const {
+    auto [left, right] = std::minmax({t[0].x, t[1].x, t[2].x});
+    auto [bottom, top] = std::minmax({t[0].y, t[1].y, t[2].y});
+    auto columns = index(left, right, grid.origin.x, grid.tileWidth, grid.columns);
+    auto rows = index(bottom, top, grid.origin.y, grid.tileHeight, grid.rows);
+    return {columns.first, columns.second, rows.first, rows.second};
+  }
+
+  // Appends the triangle part in the tile, fanned
+  void cut(const Triangle &t, size_t column, size_t row, std::pmr::vector<Triangle> &result) const {
+    Piece piece{{t[0], t[1], t[2]}, 3};
+    auto x0 = columnX(column), x1 = columnX(column + 1), y0 = rowY(row), y1 = rowY(row + 1);
+    clip(piece, [x0](Point p) { return p.x >= x0; }, [x0](Point a, Point b) { return atX(a, b, x0); });
+    clip(piece, [x1](Point p) { return p.x <= x1; }, [x1](Point a, Point b) { return atX(a, b, x1); });
+    clip(piece, [y0](Point p) { return p.y >= y0; }, [y0](Point a, Point b) { return atY(a, b, y0); });
+    clip(piece, [y1](Point p) { return p.y <= y1; }, [y1](Point a, Point b) { return atY(a, b, y1); });
+    for (size_t i = 1; i + 1 < piece.size; ++i) {
+      Triangle part{piece.points[0], piece.points[i], piece.points[i + 1]};
+      if (details::vertexOrder(part) != details::VertexOrder::NO_AREA)
+        result.push_back(part);
+    }
+  }
+
+ private:
+  // The first and the last cell of [from, to] clamped to the grid
+  static std::pair<size_t, size_t> index(double from, double to, double origin, double size, size_t count) {
+    auto first = std::floor((from - origin) / size), last = std::floor((to - origin) / size);
+    if (last < 0 || first >= static_cast<double>(count))
+      return {1, 0};
+    return {static_cast<size_t>(std::max(first, 0.0)),
+            static_cast<size_t>(std::min(last, static_cast<double>(count - 1)))};
+  }
+
+  TileGrid grid;
+};
+
+// A tile being filled
+struct TileBuilder {
+  explicit TileBuilder(std::pmr::memory_resource *memory) : welder(0, memory), triangles(memory) {}
+
+  size_t column = 0, row = 0;
+  details::PointWelder welder;
+  std::pmr::vector<Mesh::Indices> triangles;
+};
+
+} // namespace
+
+Result<std::pmr::vector<TileMesh>> tryTriangulateTiles(Ring ring, const TileGrid &grid,
+                                                       const Options &options) noexcept {
+  auto memory = options.memory ? options.memory : std::pmr::get_default_resource();
+  details::CountingResource countingMemory(memory);
+  auto tracked = options.stats ? &countingMemory : memory;
+  Result<std::pmr::vector<TileMesh>> result{Status::OK, std::pmr::vector<TileMesh>(memory)};
+  if (grid.columns == 0 || grid.rows == 0 || !(grid.tileWidth > 0) || !(grid.tileHeight > 0)) {
+    result.status = Status::INVALID_OPTIONS;
+    return result;
+  }
+
+  // The triangulation allocates from the counted memory too, so its own
+  // memory counters are dropped, they would count it twice
+  TriangulationStats triangulationStats;
+  auto report = [&]() {
+    if (!options.stats)
+      return;
+    triangulationStats.allocations = triangulationStats.allocatedBytes = triangulationStats.peakBytes = 0;
+    details::merge(*options.stats, triangulationStats);
+    // the returned meshes
+    size_t bytes = result.value.capacity() * sizeof(TileMesh), allocations = result.value.capacity() != 0;
+    for (const auto &mesh : result.value) {
+      bytes += mesh.vertices.capacity() * sizeof(Point) + mesh.triangles.capacity() * sizeof(Mesh::Indices);
+      allocations += 2;
+    }
+    if (bytes != 0)
+      countingMemory.account(bytes, allocations);
+    countingMemory.report(*options.stats);
+  };
+  auto triangulationOptions = options;
+  triangulationOptions.memory = tracked;
+  triangulationOptions.stats = options.stats ? &triangulationStats : nullptr;
+  auto triangulation = tryTriangulate(std::move(ring), triangulationOptions);
+  result.status = triangulation.status;
+  const auto &triangles = triangulation.value;
+  if (triangles.empty()) {
+    report();
+    return result;
+  }
+
+  // The triangles are bucketed by the tiles of their bounding boxes, only
+  // the part of the grid the ring covers is indexed
+  Tiling tiling(grid);
+  std::pmr::vector<TileRange> ranges(tracked);
+  ranges.reserve(triangles.size());
+  TileRange covered{SIZE_MAX, 0, SIZE_MAX, 0};
+  for (const auto &t : triangles) {
+    const auto &range = ranges.emplace_back(tiling.range(t));
+    if (range.firstColumn > range.lastColumn || range.firstRow > range.lastRow)
+      continue;
+    covered.firstColumn = std::min(covered.firstColumn, range.firstColumn);
+    covered.lastColumn = std::max(covered.lastColumn, range.lastColumn);
+    covered.firstRow = std::min(covered.firstRow, range.firstRow);
+    covered.lastRow = std::max(covered.lastRow, range.lastRow);
+  }
+  if (covered.firstColumn > covered.lastColumn) {
+    report();
+    return result;
+  }
+
+  auto width = covered.lastColumn - covered.firstColumn + 1;
+  auto height = covered.lastRow - covered.firstRow + 1;
+  auto forEachTile = [&](const TileRange &range, auto f) {
+    for (auto row = range.firstRow; row <= range.lastRow && range.firstColumn <= range.lastColumn; ++row) {
+      for (auto column = range.firstColumn; column <= range.lastColumn; ++column)
+        f((row - covered.firstRow) * width + column - covered.firstColumn);
+    }
+  };
+  std::pmr::vector<size_t> offsets(width * height + 1, 0, tracked); // CSR: triangles per tile
+  for (const auto &range : ranges)
+    forEachTile(range, [&](size_t tile) { offsets[tile + 1]++; });
+  for (size_t tile = 0; tile + 1 < offsets.size(); ++tile)
+    offsets[tile + 1] += offsets[tile];
+  std::pmr::vector<size_t> entries(offsets.back(), tracked);
+  {
+    std::pmr::vector<size_t> cursor(offsets.begin(), offsets.end() - 1, tracked);
+    for (size_t t = 0; t < triangles.size(); ++t)
+      forEachTile(ranges[t], [&](size_t tile) { entries[cursor[tile]++] = t; });
+  }
+
+  size_t filledTiles = 0;
+  for (size_t tile = 0; tile < width * height; ++tile)
+    filledTiles += offsets[tile] != offsets[tile + 1];
+  auto threads = options.threads;
+  if (threads == 0)
+    threads = entries.size() < PARALLEL_MIN_TRIANGLES ? 1 : std::thread::hardware_concurrency();
+  threads = std::clamp<size_t>(threads, 1, filledTiles);
+  // The tiles are filled in parallel, so their memory is shared between the threads
+  details::LockingResource sharedMemory(tracked);
+  auto scratch = threads > 1 ? &sharedMemory : tracked;
+
+  std::pmr::vector<TileBuilder> tiles(tracked);
+  tiles.reserve(filledTiles);
+  for (size_t tile = 0; tile < width * height; ++tile) {
+    if (offsets[tile] == offsets[tile + 1])
+      continue;
+    auto &builder = tiles.emplace_back(scratch);
+    builder.column = covered.firstColumn + tile % width;
+    builder.row = covered.firstRow + tile / width;
+  }
+
+  std::atomic<size_t> nextTile = 0;
+  std::atomic<bool> cancelled = false;
+  auto work = [&]() {
+    std::pmr::vector<Triangle> parts(scratch);
+    for (auto i = nextTile++; i < tiles.size(); i = nextTile++) {
+      if (options.cancel && *options.cancel) {
+        cancelled = true;
+        return;
+      }
+      auto &builder = tiles[i];
+      auto tile = (builder.row - covered.firstRow) * width + builder.column - covered.firstColumn;
+      parts.clear();
+      for (auto k = offsets[tile]; k < offsets[tile + 1]; ++k)
+        tiling.cut(triangles[entries[k]], builder.column, builder.row, parts);
+      builder.triangles.reserve(parts.size());
+      for (const auto &part : parts) {
+        builder.triangles.push_back({static_cast<uint32_t>(builder.welder.weld(part[0])),
+                                     static_cast<uint32_t>(builder.welder.weld(part[1])),
+                                     static_cast<uint32_t>(builder.welder.weld(part[2]))});
+      }
+    }
+  };
+
+  {
+    std::pmr::vector<std::thread> workers(tracked);
+    workers.reserve(threads - 1);
+    for (size_t thread = 1; thread < threads; ++thread)
+      workers.emplace_back(work);
+    work();
+    for (auto &worker : workers)
+      worker.join();
+  }
+  if (cancelled) {
+    result.status = Status::CANCELLED;
+    report();
+    return result;
+  }
+
+  auto &meshes = result.value;
+  for (const auto &builder : tiles) {
+    if (builder.triangles.empty())
+      continue;
+    const auto &points = builder.welder.points();
+    meshes.push_back({builder.column, builder.row, std::pmr::vector<Point>(points.begin(), points.end(), memory),
+                      std::pmr::vector<Mesh::Indices>(builder.triangles.begin(), builder.triangles.end(), memory)});
+  }
+  report();
+  return result;
+}
+
+std::pmr::vector<TileMesh> triangulateTiles(Ring ring, const TileGrid &grid, const Options &options) {
+  auto result = tryTriangulateTiles(std::move(ring), grid, options);
+  details::raiseIfFailed(result.status);
+  return std::move(result.value);
+}
+
+} // namespace ear_clip
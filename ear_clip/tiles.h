@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ear_clip.h"
+
+namespace ear_clip {
+
+// columns x rows tiles of the same size, the tile (0, 0) has the least coordinates
+struct TileGrid {
+  Point origin{0, 0};
+  double tileWidth = 0, tileHeight = 0;
+  size_t columns = 0, rows = 0;
+};
+
+// The part of the triangulation in a tile. The triangles are indices of the
+// tile vertices. A point where a triangle edge crosses the tile border gets
+// the same coordinates in both tiles.
+struct TileMesh {
+  size_t column = 0, row = 0;
+  std::pmr::vector<Point> vertices;
+  std::pmr::vector<Mesh::Indices> triangles;
+};
+
+// The ring triangulation cut by the tile grid, in one call: the ring is
+// normalized and clipped once, and each triangle is cut by the tiles it
+// overlaps. The pieces are convex, so they are fanned, no fragment is
+// triangulated again. The tiles are filled by options.threads. The memory
+// counters of options.stats include the tiling.
+//
+// Only the tiles with triangles are returned, ordered by (row, column). The
+// parts out of the grid are dropped. The status is the tryTriangulate()
+// one, or INVALID_OPTIONS for an empty grid or not a positive tile size.
+Result<std::pmr::vector<TileMesh>> tryTriangulateTiles(Ring ring, const TileGrid &grid,
+                                                       const Options &options = {}) noexcept;
+std::pmr::vector<TileMesh> triangulateTiles(Ring ring, const TileGrid &grid, const Options &options = {});
+
+} // namespace ear_clip
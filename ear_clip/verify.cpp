@@ -0,0 +1,231 @@
+#include "verify.h"
+
+#include "delaunay.h"
+#include "point_welder.h"
+#include "simplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace ear_clip {
+
+namespace {
+
+// Relative, the self intersection points are rounded
+constexpr double AREA_TOLERANCE = 1e-7;
+
+// Shoelace, > 0 - counterclockwise
+double signedArea(const Ring &ring) {
+  double result = 0;
+  if (ring.empty())
+    return result;
+  for (auto i = ring.begin(), j = std::prev(ring.end()); i != ring.end(); j = i++)
+    result += j->x * i->y - i->x * j->y;
+  return result / 2;
+}
+
+// Some edge of the triangle has all the other triangle on its outer side or on it
+bool separates(const Triangle &t, double sign, const Triangle &other) {
+  for (size_t i = 0; i < 3; ++i) {
+    bool outside = true;
+    for (const auto &p : other) {
+      // the common vertices are on the edge line, no need for the exact predicate
+      if (!(p == t[i]) && !(p == t[(i + 1) % 3]))
+        outside &= sign * details::orient(t[i], t[(i + 1) % 3], p) <= 0;
+    }
+    if (outside)
+      return true;
+  }
+  return false;
+}
+
+// Finds the overlapping pairs of the non degenerate triangles. They are
+// bucketed into a grid of about one cell per triangle, a pair is tested in the
+// first cell they share only. Fans put many triangles into one cell, so it's
+// only used to explain a boundary mismatch.
+void findOverlaps(const Triangles &output, const std::pmr::vector<double> &signs, VerificationReport &report,
+                  std::pmr::memory_resource *memory) {
+  double left = std::numeric_limits<double>::max(), bottom = left;
+  double right = std::numeric_limits<double>::lowest(), top = right;
+  size_t solid = 0;
+  for (size_t i = 0; i < output.size(); ++i) {
+    if (signs[i] == 0)
+      continue;
+    solid++;
+    for (const auto &p : output[i]) {
+      left = std::min(left, p.x);
+      right = std::max(right, p.x);
+      bottom = std::min(bottom, p.y);
+      top = std::max(top, p.y);
+    }
+  }
+  if (solid < 2)
+    return;
+
+  auto side = std::max(std::sqrt((right - left) * (top - bottom) / static_cast<double>(solid)),
+                       std::numeric_limits<double>::min());
+  auto columns = std::clamp<size_t>(static_cast<size_t>((right - left) / side), 1, solid);
+  auto rows = std::clamp<size_t>(static_cast<size_t>((top - bottom) / side), 1, solid);
+  auto cellWidth = std::max((right - left) / static_cast<double>(columns), std::numeric_limits<double>::min());
+  auto cellHeight = std::max((top - bottom) / static_cast<double>(rows), std::numeric_limits<double>::min());
+  auto column = [&](double x) {
+    return std::min(columns - 1, static_cast<size_t>(std::max(0.0, (x - left) / cellWidth)));
+  };
+  auto row = [&](double y) {
+    return std::min(rows - 1, static_cast<size_t>(std::max(0.0, (y - bottom) / cellHeight)));
+  };
+
+  struct Range {
+    size_t c0, c1, r0, r1;
+  };
+  std::pmr::vector<Range> ranges(output.size(), Range{}, memory);
+  std::pmr::vector<size_t> offsets(columns * rows + 1, 0, memory);
+  for (size_t i = 0; i < output.size(); ++i) {
+    if (signs[i] == 0)
+      continue;
+    const auto &t = output[i];
+    auto &range = ranges[i];
+    range = {column(std::min({t[0].x, t[1].x, t[2].x})), column(std::max({t[0].x, t[1].x, t[2].x})),
+             row(std::min({t[0].y, t[1].y, t[2].y})), row(std::max({t[0].y, t[1].y, t[2].y}))};
+    for (auto r = range.r0; r <= range.r1; ++r) {
+      for (auto c = range.c0; c <= range.c1; ++c)
+        offsets[r * columns + c + 1]++;
+    }
+  }
+  for (size_t c = 0; c + 1 < offsets.size(); ++c)
+    offsets[c + 1] += offsets[c];
+  std::pmr::vector<size_t> entries(offsets.back(), memory);
+  {
+    std::pmr::vector<size_t> cursor(offsets.begin(), offsets.end() - 1, memory);
+    for (size_t i = 0; i < output.size(); ++i) {
+      if (signs[i] == 0)
+        continue;
+      const auto &range = ranges[i];
+      for (auto r = range.r0; r <= range.r1; ++r) {
+        for (auto c = range.c0; c <= range.c1; ++c)
+          entries[cursor[r * columns + c]++] = i;
+      }
+    }
+  }
+
+  for (size_t cell = 0; cell + 1 < offsets.size(); ++cell) {
+    for (auto k = offsets[cell]; k < offsets[cell + 1]; ++k) {
+      for (auto l = k + 1; l < offsets[cell + 1]; ++l) {
+        auto a = entries[k], b = entries[l];
+        const auto &ra = ranges[a], &rb = ranges[b];
+        if (std::max(ra.r0, rb.r0) * columns + std::max(ra.c0, rb.c0) != cell)
+          continue;
+        if (separates(output[a], signs[a], output[b]) || separates(output[b], signs[b], output[a]))
+          continue;
+        if (report.overlappingPairs++ == 0)
+          report.firstOverlap = std::pair(a, b);
+      }
+    }
+  }
+}
+
+// Compares the boundaries of the counterclockwise triangles and faces as
+// sums of directed edges. If they are equal, every point off the edges is in
+// as many triangles as faces, and the faces don't overlap, so neither do the
+// triangles.
+bool sameBoundary(const std::pmr::vector<Ring> &faces, const Triangles &triangles,
+                  const std::pmr::vector<double> &signs, std::pmr::memory_resource *memory) {
+  details::PointWelder welder(0, memory);
+  // (lower id, higher id), +1 from the lower to the higher, -1 back
+  std::pmr::vector<std::pair<std::pair<size_t, size_t>, int>> edges(memory);
+  auto add = [&](Point from, Point to, int weight) {
+    auto a = welder.weld(from), b = welder.weld(to);
+    if (a == b)
+      return;
+    if (a < b)
+      edges.push_back({{a, b}, weight});
+    else
+      edges.push_back({{b, a}, -weight});
+  };
+
+  for (const auto &face : faces) {
+    auto weight = signedArea(face) > 0 ? 1 : -1;
+    for (auto i = face.begin(), j = std::prev(face.end()); i != face.end(); j = i++)
+      add(*j, *i, weight);
+  }
+  for (size_t t = 0; t < triangles.size(); ++t) {
+    if (signs[t] == 0)
+      continue;
+    auto weight = signs[t] > 0 ? -1 : 1;
+    for (size_t i = 0; i < 3; ++i)
+      add(triangles[t][i], triangles[t][(i + 1) % 3], weight);
+  }
+
+  std::sort(edges.begin(), edges.end());
+  for (size_t begin = 0, end = 0; begin < edges.size(); begin = end) {
+    int sum = 0;
+    for (end = begin; end < edges.size() && edges[end].first == edges[begin].first; ++end)
+      sum += edges[end].second;
+    if (sum != 0)
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+bool VerificationReport::areaMatches() const {
+  return std::abs(area - expectedArea) <= AREA_TOLERANCE * std::max(area, expectedArea);
+}
+
+VerificationReport verifyTriangulation(const Ring &input, const Triangles &output, const Options &options) {
+  auto memory = options.memory ? options.memory : std::pmr::get_default_resource();
+  VerificationReport report;
+  report.triangles = output.size();
+
+  // The reference faces, the ring is prepared the same way as by triangulate().
+  // Without a fill rule, the clipped ring covers its non zero winding faces.
+  Options normalizeOptions = options;
+  normalizeOptions.stats = nullptr;
+  Ring ring(input.begin(), input.end(), memory);
+  if (options.simplifyTolerance)
+    ring = simplify(std::move(ring), *options.simplifyTolerance, memory);
+  auto faces = details::normalizeFaces(std::move(ring), options.fillRule.value_or(FillRule::NON_ZERO),
+                                       normalizeOptions);
+  for (const auto &face : faces)
+    report.expectedArea += std::abs(signedArea(face));
+
+  // Without a fill rule the triangles are clipped with the orientation of the
+  // normalized ring, > 0 - counterclockwise, 0 - not checked
+  double ringSign = 0;
+  if (!options.fillRule) {
+    Ring normalized(input.begin(), input.end(), memory);
+    if (options.simplifyTolerance)
+      normalized = simplify(std::move(normalized), *options.simplifyTolerance, memory);
+    normalized = details::normalizeRing(std::move(normalized), normalizeOptions);
+    auto order = normalized.size() > 2 ? details::vertexOrder(normalized) : details::VertexOrder::NO_AREA;
+    if (order != details::VertexOrder::NO_AREA)
+      ringSign = order == details::VertexOrder::CLOCKWISE ? -1 : 1;
+  }
+
+  // Areas and orientations
+  std::pmr::vector<double> signs(output.size(), 0, memory);
+  for (size_t i = 0; i < output.size(); ++i) {
+    const auto &t = output[i];
+    auto orientation = details::orient(t[0], t[1], t[2]);
+    report.area += std::abs((t[1].x - t[0].x) * (t[2].y - t[0].y) - (t[1].y - t[0].y) * (t[2].x - t[0].x)) / 2;
+    if (orientation == 0) {
+      report.degenerateTriangles++;
+      continue;
+    }
+    signs[i] = orientation > 0 ? 1 : -1;
+    // All the triangles of one ring have its orientation, the faces may have different ones
+    if (ringSign != 0 && signs[i] != ringSign)
+      report.wrongOrientation++;
+  }
+
+  report.boundaryMatches = sameBoundary(faces, output, signs, memory);
+  if (!report.boundaryMatches)
+    findOverlaps(output, signs, report, memory);
+
+  return report;
+}
+
+} // namespace ear_clip
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ear_clip.h"
+
+#include <optional>
+#include <utility>
+
+namespace ear_clip {
+
+struct VerificationReport {
+  size_t triangles = 0;
+  double expectedArea = 0;         // of the ring faces
+  double area = 0;                 // of the triangles
+  size_t degenerateTriangles = 0;  // zero area ones, they don't make the output invalid
+  size_t wrongOrientation = 0;     // triangles which don't have the ring orientation
+  // The triangles edges which aren't shared by two of them make up the faces
+  // boundaries. It proves there are no overlaps.
+  bool boundaryMatches = false;
+  // Only searched for if the boundary doesn't match
+  size_t overlappingPairs = 0;     // triangles with a common interior point
+  std::optional<std::pair<size_t, size_t>> firstOverlap;
+
+  [[nodiscard]] bool areaMatches() const;
+  [[nodiscard]] bool valid() const { return areaMatches() && wrongOrientation == 0 && overlappingPairs == 0; }
+};
+
+// Checks the triangulate(input, options) output without the expected
+// triangles: the area is the area of the ring faces(non zero winding ones
+// without a fill rule), all the triangles have the ring orientation(not
+// checked with a fill rule, as the faces may have different ones) and no two
+// triangles overlap.
+//
+// The overlaps check is a comparison of the triangles and faces boundaries
+// as sums of directed edges, O(n log n) plus the normalization cost. Only if
+// it fails, the overlapping pairs are searched in a grid of the triangles
+// with the exact orientation predicate.
+VerificationReport verifyTriangulation(const Ring &input, const Triangles &output, const Options &options = {});
+
+} // namespace ear_clip
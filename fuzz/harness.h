@@ -0,0 +1,93 @@
+#pragma once
+
+#include "ear_clip.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace ear_clip::fuzz {
+
+// A fuzz input: a flags byte, then the ring points as little endian int16
+// pairs. The small integer coordinates make the coincident and collinear
+// vertices, the overlapping edges and the self intersections common.
+//
+// Flags: bits 0-1 - the fill rule(1 - NON_ZERO, 2 - EVEN_ODD, otherwise
+// none), bit 2 - snapTolerance = 1.
+struct Input {
+  Ring ring;
+  Options options;
+};
+
+inline Input decode(const uint8_t *data, size_t size) {
+  Input result;
+  result.options.threads = 1; // the timing shouldn't depend on the machine
+  if (size == 0)
+    return result;
+
+  switch (data[0] & 3) {
+    case 1:result.options.fillRule = FillRule::NON_ZERO;
+      break;
+    case 2:result.options.fillRule = FillRule::EVEN_ODD;
+      break;
+    default:break;
+  }
+  if (data[0] & 4)
+    result.options.snapTolerance = 1;
+
+  auto coordinate = [](const uint8_t *p) {
+    return static_cast<double>(static_cast<int16_t>(static_cast<uint16_t>(p[0] | p[1] << 8)));
+  };
+  for (size_t i = 1; i + 4 <= size; i += 4)
+    result.ring.push_back({coordinate(data + i), coordinate(data + i + 2)});
+  return result;
+}
+
+// The limits an input is flagged by
+struct Limits {
+  // Wall time per vertex of the split ring(the input and the self
+  // intersection points, as their count is quadratic). Random rings take a
+  // few microseconds; EAR_CLIP_FUZZ_NS_PER_VERTEX overrides it(e.g. for the
+  // sanitizer builds).
+  std::chrono::nanoseconds timePerVertex{20'000};
+  // triangulate() output is checked with verifyTriangulation() if EAR_CLIP_FUZZ_VERIFY is set
+  bool verify = false;
+
+  static const Limits &get() {
+    static const Limits limits = [] {
+      Limits result;
+      if (auto value = std::getenv("EAR_CLIP_FUZZ_NS_PER_VERTEX"))
+        result.timePerVertex = std::chrono::nanoseconds(std::strtoll(value, nullptr, 10));
+      result.verify = std::getenv("EAR_CLIP_FUZZ_VERIFY") != nullptr;
+      return result;
+    }();
+    return limits;
+  }
+};
+
+// Reports the input and aborts, so libFuzzer saves it(and minimizes it with -minimize_crash=1)
+[[noreturn]] inline void flag(const std::string &what, const Input &input) {
+  std::cerr << "ear_clip fuzz: " << what << ", " << input.ring.size() << " vertices:";
+  for (const auto &p : input.ring)
+    std::cerr << ' ' << p.x << ' ' << p.y;
+  std::cerr << std::endl;
+  std::abort();
+}
+
+template <class F>
+std::chrono::nanoseconds measure(F &&f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+}
+
+inline void checkTime(std::chrono::nanoseconds time, size_t vertices, const Input &input) {
+  auto perVertex = time / static_cast<std::chrono::nanoseconds::rep>(std::max<size_t>(vertices, 1));
+  if (perVertex > Limits::get().timePerVertex)
+    flag("slow, " + std::to_string(perVertex.count()) + " ns per vertex", input);
+}
+
+} // namespace ear_clip::fuzz
@@ -0,0 +1,31 @@
+#include "harness.h"
+
+using namespace ear_clip;
+
+// normalizeRing(), or normalizeFaces() if the input has a fill rule
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  static const bool traceDisabled = (enableTrace(false), true);
+  (void)traceDisabled;
+
+  auto input = fuzz::decode(data, size);
+  TriangulationStats stats;
+  auto options = input.options;
+  options.stats = &stats;
+  size_t vertices = 0;
+  auto time = fuzz::measure([&]() {
+    if (options.fillRule) {
+      for (const auto &face : details::normalizeFaces(input.ring, *options.fillRule, options))
+        vertices += face.size();
+    } else {
+      vertices = details::normalizeRing(input.ring, options).size();
+    }
+  });
+  fuzz::checkTime(time, input.ring.size() + stats.splitPoints, input);
+
+  // The split ring has up to n + 2 * splitPoints edges. The ring traversal
+  // takes each of them once, a face walk - each side once.
+  auto edges = input.ring.size() + 2 * stats.splitPoints;
+  if (vertices > (options.fillRule ? 2 * edges : edges))
+    fuzz::flag("runaway traversal, " + std::to_string(vertices) + " vertices", input);
+  return 0;
+}
@@ -0,0 +1,44 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+// Runs the fuzz target over the inputs without libFuzzer, so the targets
+// build with any compiler. Directories are replayed file by file.
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace {
+
+void replay(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  LLVMFuzzerTestOneInput(data.data(), data.size());
+}
+
+} // namespace
+
+// Usage: <target> <file or directory>...
+int main(int argc, char *argv[]) {
+  size_t inputs = 0;
+  for (int i = 1; i < argc; ++i) {
+    std::vector<std::filesystem::path> paths;
+    if (std::filesystem::is_directory(argv[i])) {
+      for (const auto &entry : std::filesystem::directory_iterator(argv[i]))
+        paths.push_back(entry.path());
+      std::sort(paths.begin(), paths.end());
+    } else {
+      paths.emplace_back(argv[i]);
+    }
+    for (const auto &path : paths) {
+      replay(path);
+      inputs++;
+    }
+  }
+  std::cout << inputs << " inputs replayed\n";
+  return EXIT_SUCCESS;
+}
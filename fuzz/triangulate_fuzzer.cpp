@@ -0,0 +1,29 @@
+#include "harness.h"
+#include "verify.h"
+
+using namespace ear_clip;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  static const bool traceDisabled = (enableTrace(false), true);
+  (void)traceDisabled;
+
+  auto input = fuzz::decode(data, size);
+  TriangulationStats stats;
+  auto options = input.options;
+  options.stats = &stats;
+  Triangles triangles;
+  auto time = fuzz::measure([&]() { triangles = triangulate(input.ring, options); });
+  fuzz::checkTime(time, input.ring.size() + stats.splitPoints, input);
+
+  // The split ring has up to n + 2 * splitPoints edges, each one is on two
+  // faces at most. A clip loop iteration either clips an ear or skips a
+  // vertex, and no more than the ring size are skipped in a row.
+  auto vertices = 2 * (input.ring.size() + 2 * stats.splitPoints);
+  auto iterations = triangles.size() + stats.rejectedEars;
+  if (iterations > vertices * vertices + vertices)
+    fuzz::flag("runaway clip loop, " + std::to_string(iterations) + " iterations", input);
+
+  if (fuzz::Limits::get().verify && !verifyTriangulation(input.ring, triangles, input.options).valid())
+    fuzz::flag("invalid triangulation", input);
+  return 0;
+}
@@ -0,0 +1,386 @@
+#include "dataset.h"
+#include "paint_area.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+constexpr char BINARY_MAGIC[] = "ECPOLY01";
+constexpr size_t BINARY_MAGIC_SIZE = sizeof(BINARY_MAGIC) - 1;
+
+// Rects may have zero size, so QRectF::intersects() doesn't fit
+bool overlaps(const QRectF &a, const QRectF &b) {
+  return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+QRectF bBoxOf(const Dataset::Ring &ring) {
+  auto [minX, maxX] = std::minmax_element(ring.begin(), ring.end(), [](auto a, auto b) { return a.x() < b.x(); });
+  auto [minY, maxY] = std::minmax_element(ring.begin(), ring.end(), [](auto a, auto b) { return a.y() < b.y(); });
+  return QRectF(QPointF(minX->x(), minY->y()), QPointF(maxX->x(), maxY->y()));
+}
+
+void addRing(Dataset::Ring &&ring, std::vector<Dataset::Ring> &rings) {
+  if (ring.size() > 1 && ring.front() == ring.back())
+    ring.pop_back();
+  if (ring.size() > 2)
+    rings.push_back(std::move(ring));
+}
+
+// Reports the parsed share of the file, checks the cancellation
+class Progress {
+ public:
+  Progress(size_t size, const std::atomic<bool> &cancel, std::function<void(int)> report)
+      : size(size), cancel(cancel), report(std::move(report)) {}
+
+  void at(size_t offset) {
+    if (cancel)
+      throw ear_clip::Cancelled();
+    auto percent = size == 0 ? 100 : static_cast<int>(offset * 100 / size);
+    if (percent != last) {
+      last = percent;
+      report(percent);
+    }
+  }
+
+ private:
+  size_t size;
+  const std::atomic<bool> &cancel;
+  std::function<void(int)> report;
+  int last = -1;
+};
+
+void parseBinary(const uchar *begin, const uchar *end, std::vector<Dataset::Ring> &rings, Progress &progress) {
+  auto p = begin + BINARY_MAGIC_SIZE;
+  auto read = [&](void *to, size_t bytes) {
+    if (static_cast<size_t>(end - p) < bytes)
+      throw std::runtime_error("Truncated binary polygons file");
+    std::memcpy(to, p, bytes);
+    p += bytes;
+  };
+
+  uint32_t count;
+  read(&count, sizeof(count));
+  rings.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    progress.at(p - begin);
+    uint32_t points;
+    read(&points, sizeof(points));
+    if (static_cast<size_t>(end - p) / (2 * sizeof(double)) < points)
+      throw std::runtime_error("Truncated binary polygons file");
+
+    Dataset::Ring ring;
+    ring.reserve(static_cast<int>(points));
+    for (uint32_t j = 0; j < points; ++j) {
+      double xy[2];
+      read(xy, sizeof(xy));
+      ring.push_back({xy[0], xy[1]});
+    }
+    addRing(std::move(ring), rings);
+  }
+}
+
+// The innermost parentheses are rings. A ring which opens right after
+// another parenthesis is a shell, the ones after a comma are holes.
+void parseWkt(const char *begin, const char *end, std::vector<Dataset::Ring> &rings, Progress &progress) {
+  constexpr size_t PROGRESS_STEP = 1 << 20;
+  Dataset::Ring ring;
+  bool inRing = false, isShell = false;
+  char previous = 0; // the last significant char
+  double coordinates[2];
+  size_t coordinatesCount = 0;
+  auto addPoint = [&]() {
+    if (coordinatesCount >= 2 && isShell)
+      ring.push_back({coordinates[0], coordinates[1]});
+    coordinatesCount = 0; // z and m are skipped
+  };
+
+  size_t nextReport = 0;
+  for (auto p = begin; p != end;) {
+    if (static_cast<size_t>(p - begin) >= nextReport) {
+      progress.at(p - begin);
+      nextReport += PROGRESS_STEP;
+    }
+
+    auto c = *p;
+    if (inRing && (std::isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '+' || c == '.')) {
+      char number[64];
+      size_t length = 0;
+      for (; p != end && length + 1 < sizeof(number) &&
+          (std::isdigit(static_cast<unsigned char>(*p)) || std::strchr("+-.eE", *p)); ++p)
+        number[length++] = *p;
+      number[length] = 0;
+      if (coordinatesCount < 2)
+        coordinates[coordinatesCount] = std::strtod(number, nullptr);
+      ++coordinatesCount;
+      previous = '0';
+      continue;
+    }
+
+    switch (c) {
+      case '(':
+        inRing = true;
+        isShell = previous == '(';
+        ring.clear();
+        coordinatesCount = 0;
+        break;
+      case ',':
+        if (inRing)
+          addPoint();
+        break;
+      case ')':
+        if (inRing) {
+          addPoint();
+          if (isShell)
+            addRing(std::move(ring), rings);
+          ring = {};
+        }
+        inRing = false;
+        break;
+      default:break;
+    }
+
+    if (!std::isspace(static_cast<unsigned char>(c)))
+      previous = c;
+    ++p;
+  }
+}
+
+} // namespace
+
+GridIndex::GridIndex(const std::vector<BBox> &bBoxes)
+    : bBoxes(bBoxes) {
+  if (bBoxes.empty())
+    return;
+
+  bBox = bBoxes.front();
+  for (const auto &b : bBoxes)
+    bBox = bBox.united(b);
+
+  columns = rows = std::max(1, static_cast<int>(std::sqrt(bBoxes.size())));
+  cells.resize(static_cast<size_t>(columns) * rows);
+  for (uint32_t id = 0; id < bBoxes.size(); ++id) {
+    auto [c0, r0] = cell(bBoxes[id].topLeft());
+    auto [c1, r1] = cell(bBoxes[id].bottomRight());
+    for (auto r = r0; r <= r1; ++r) {
+      for (auto c = c0; c <= c1; ++c)
+        cells[static_cast<size_t>(r) * columns + c].push_back(id);
+    }
+  }
+}
+
+std::pair<int, int> GridIndex::cell(QPointF p) const {
+  auto index = [](double v, double from, double size, int count) {
+    if (size <= 0)
+      return 0;
+    return std::clamp(static_cast<int>((v - from) / size * count), 0, count - 1);
+  };
+  return {index(p.x(), bBox.left(), bBox.width(), columns), index(p.y(), bBox.top(), bBox.height(), rows)};
+}
+
+std::vector<uint32_t> GridIndex::query(const BBox &rect) const {
+  std::vector<uint32_t> result;
+  if (cells.empty() || !overlaps(bBox, rect))
+    return result;
+
+  auto [c0, r0] = cell(rect.topLeft());
+  auto [c1, r1] = cell(rect.bottomRight());
+  for (auto r = r0; r <= r1; ++r) {
+    for (auto c = c0; c <= c1; ++c) {
+      for (auto id : cells[static_cast<size_t>(r) * columns + c]) {
+        if (overlaps(bBoxes[id], rect))
+          result.push_back(id);
+      }
+    }
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+Dataset::Dataset() {
+  start();
+}
+
+Dataset::~Dataset() {
+  {
+    QMutexLocker lock(&mutex);
+    stopping = true;
+    cancelLoad = true;
+    cancelTriangulation = true;
+    jobReady.wakeOne();
+  }
+  wait();
+}
+
+void Dataset::load(QString newPath) {
+  QMutexLocker lock(&mutex);
+  path = std::move(newPath);
+  cancelLoad = true;
+  cancelTriangulation = true;
+  jobReady.wakeOne();
+}
+
+void Dataset::triangulateVisible(BBox rect) {
+  QMutexLocker lock(&mutex);
+  visibleRect = rect;
+  cancelTriangulation = true;
+  jobReady.wakeOne();
+}
+
+std::shared_ptr<const Dataset::Data> Dataset::getData() const {
+  return std::atomic_load(&data);
+}
+
+std::optional<QString> Dataset::getError() const {
+  QMutexLocker lock(&mutex);
+  return error;
+}
+
+void Dataset::run() {
+  while (true) {
+    std::optional<QString> loadPath;
+    std::optional<BBox> rect;
+    {
+      QMutexLocker lock(&mutex);
+      while (!stopping && !path && !visibleRect)
+        jobReady.wait(&mutex);
+      if (stopping)
+        return;
+
+      // A new file makes the view stale
+      if (path) {
+        std::swap(loadPath, path);
+        visibleRect.reset();
+        error.reset();
+        cancelLoad = false;
+      } else {
+        std::swap(rect, visibleRect);
+      }
+      cancelTriangulation = false;
+    }
+
+    try {
+      if (loadPath) {
+        loadFile(*loadPath);
+      } else if (auto d = getData()) {
+        triangulate(*d, *rect);
+      }
+    }
+    catch (const ear_clip::Cancelled &) {
+    }
+    catch (const std::exception &e) {
+      {
+        QMutexLocker lock(&mutex);
+        error = QString(e.what());
+      }
+      emit loaded();
+    }
+  }
+}
+
+void Dataset::loadFile(const QString &filePath) {
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly))
+    throw std::runtime_error(file.errorString().toStdString());
+
+  auto size = static_cast<size_t>(file.size());
+  const uchar *memory = size == 0 ? nullptr : file.map(0, file.size());
+  if (size != 0 && !memory)
+    throw std::runtime_error(file.errorString().toStdString());
+
+  auto newData = std::make_shared<Data>();
+  Progress progressReporter(size, cancelLoad, [this](int percent) { emit progress(percent); });
+  if (size >= BINARY_MAGIC_SIZE && std::memcmp(memory, BINARY_MAGIC, BINARY_MAGIC_SIZE) == 0) {
+    parseBinary(memory, memory + size, newData->rings, progressReporter);
+  } else {
+    auto text = reinterpret_cast<const char *>(memory);
+    parseWkt(text, text + size, newData->rings, progressReporter);
+  }
+  file.unmap(const_cast<uchar *>(memory));
+
+  newData->bBoxes.reserve(newData->rings.size());
+  for (const auto &ring : newData->rings) {
+    newData->bBoxes.push_back(bBoxOf(ring));
+    newData->bBox = newData->bBox.isNull() ? newData->bBoxes.back() : newData->bBox.united(newData->bBoxes.back());
+  }
+  newData->index = GridIndex(newData->bBoxes);
+  newData->triangles.resize(newData->rings.size());
+
+  std::atomic_store(&data, std::shared_ptr<const Data>(std::move(newData)));
+  progressReporter.at(size);
+  emit loaded();
+}
+
+void Dataset::triangulate(const Data &d, const BBox &rect) {
+  std::vector<uint32_t> ids;
+  for (auto id : d.index.query(rect)) {
+    if (!std::atomic_load(&d.triangles[id]))
+      ids.push_back(id);
+  }
+  if (ids.empty())
+    return;
+
+  std::atomic<size_t> next{0};
+  auto work = [&]() {
+    ear_clip::Options options;
+    options.cancel = &cancelTriangulation;
+    options.threads = 1; // the polygons are parallel already
+    for (auto i = next++; i < ids.size(); i = next++) {
+      ear_clip::Ring ring;
+      for (auto p : d.rings[ids[i]])
+        ring.push_back({p.x(), p.y()});
+
+      // A failed polygon is left without triangles, it isn't tried again
+      auto result = ear_clip::tryTriangulate(std::move(ring), options);
+      if (result.status == ear_clip::Status::CANCELLED)
+        return;
+      auto edges = std::make_shared<QVector<QLineF>>();
+      edges->reserve(static_cast<int>(result.value.size() * 3));
+      for (const auto &t : result.value) {
+        for (size_t j = 0; j < 3; ++j)
+          edges->push_back({t[j].x, t[j].y, t[(j + 1) % 3].x, t[(j + 1) % 3].y});
+      }
+      std::atomic_store(&d.triangles[ids[i]], std::shared_ptr<const QVector<QLineF>>(std::move(edges)));
+    }
+  };
+
+  auto threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, ids.size());
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threads; ++i)
+    workers.emplace_back(work);
+  work();
+  for (auto &worker : workers)
+    worker.join();
+
+  emit triangulated();
+}
+
+void Dataset::draw(QPainter &painter, const QTransform &transform) {
+  auto d = getData();
+  if (!d)
+    return;
+
+  auto viewport = painter.viewport();
+  auto rect = transform.inverted().mapRect(QRectF(viewport));
+  QVector<QLineF> outlines, triangleEdges;
+  for (auto id : d->index.query(rect)) {
+    const auto &ring = d->rings[id];
+    for (int i = 0; i < ring.size(); ++i)
+      outlines.push_back({ring[i], ring[(i + 1) % ring.size()]});
+    if (auto edges = std::atomic_load(&d->triangles[id]))
+      triangleEdges += *edges;
+  }
+
+  painter.setPen(QPen(Qt::green, 1));
+  painter.drawLines(visibleLines(triangleEdges, transform, viewport));
+  painter.setPen(QPen(Qt::black, 1));
+  painter.drawLines(visibleLines(outlines, transform, viewport));
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "ear_clip.h"
+
+#include <QMutex>
+#include <QPainter>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Uniform grid of the polygon bboxes
+class GridIndex {
+ public:
+  using BBox = QRectF;
+
+  GridIndex() = default;
+  explicit GridIndex(const std::vector<BBox> &bBoxes);
+
+  // Ids(indices in the source vector) of the bboxes intersecting the rect, sorted
+  std::vector<uint32_t> query(const BBox &rect) const;
+
+ private:
+  std::pair<int, int> cell(QPointF p) const;
+
+  BBox bBox;
+  int columns = 0, rows = 0;
+  std::vector<std::vector<uint32_t>> cells;
+  std::vector<BBox> bBoxes;
+};
+
+// A large multi polygon dataset viewer. A file is memory mapped and parsed
+// in a background thread, polygons in view are triangulated in parallel.
+//
+// Formats:
+//  - WKT: POLYGON and MULTIPOLYGON, only the shells are taken(holes aren't supported)
+//  - binary: "ECPOLY01", uint32 rings count, then each ring as uint32 points
+//    count and x, y doubles(little endian)
+class Dataset : public QThread {
+ Q_OBJECT
+ public:
+  using Point = QPointF;
+  using Ring = QVector<Point>;
+  using BBox = QRectF;
+
+  // Immutable once loaded
+  struct Data {
+    std::vector<Ring> rings;
+    std::vector<BBox> bBoxes;
+    BBox bBox;
+    GridIndex index;
+    // Triangle edges of the ring, set by the triangulation workers
+    // only accessed by the std::atomic_* functions
+    mutable std::vector<std::shared_ptr<const QVector<QLineF>>> triangles;
+  };
+
+  Dataset();
+  ~Dataset() override;
+
+  void load(QString path);
+  // Triangulates the polygons in the rect, which aren't triangulated yet
+  void triangulateVisible(BBox rect);
+  std::shared_ptr<const Data> getData() const;
+  std::optional<QString> getError() const;
+
+  void draw(QPainter &painter, const QTransform &transform);
+
+ signals:
+  // These are emitted from the worker thread
+  void progress(int percent);
+  void loaded();
+  void triangulated();
+
+ private:
+  void run() final;
+  void loadFile(const QString &filePath);
+  void triangulate(const Data &data, const BBox &rect);
+
+  mutable QMutex mutex;
+  QWaitCondition jobReady;
+  // guarded by the mutex
+  std::optional<QString> path;
+  std::optional<BBox> visibleRect;
+  std::optional<QString> error;
+  bool stopping = false;
+
+  std::atomic<bool> cancelLoad{false};
+  std::atomic<bool> cancelTriangulation{false};
+  std::shared_ptr<const Data> data; // only accessed by the std::atomic_* functions
+};
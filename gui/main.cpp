@@ -1,3 +1,4 @@
+#include "dataset.h"
 #include "main_window.h"
 
 #include "polygon_builder.h"
@@ -11,6 +12,8 @@
 
 int main(int argc, char *argv[]) {
   QApplication app(argc, argv);
+  // Once, before the workers start: tracing every preview would dominate its latency
+  ear_clip::enableTrace(false);
 
   PolygonBuilder::Ring ring;
   std::set<std::string> keys(argv, argv + argc);
@@ -26,8 +29,14 @@ int main(int argc, char *argv[]) {
 
   PolygonBuilder polygonBuilder(ring);
   Triangulation triangulation;
+  Dataset dataset;
 
-  MainWindow mainWindow(&polygonBuilder, &triangulation);
+  MainWindow mainWindow(&polygonBuilder, &triangulation, &dataset);
+  // -f <file>: a WKT or binary polygons dataset
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (std::string(argv[i]) == "-f")
+      dataset.load(argv[i + 1]);
+  }
 
   mainWindow.setWindowState(Qt::WindowMaximized);
   mainWindow.show();
@@ -1,10 +1,17 @@
 #include "main_window.h"
 
+#include <QFileDialog>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QMessageBox>
 
-MainWindow::MainWindow(PolygonBuilder *polygonBuilder, Triangulation *triangulation, QWidget *p)
+namespace {
+
+// Edits within the delay are coalesced into one preview triangulation
+constexpr int PREVIEW_DELAY_MS = 30;
+
+} // namespace
+
+MainWindow::MainWindow(PolygonBuilder *polygonBuilder, Triangulation *triangulation, Dataset *dataset, QWidget *p)
     : QWidget(p), polygonBuilder(polygonBuilder) {
   auto mainLayout = new QVBoxLayout();
 
@@ -20,6 +27,10 @@ MainWindow::MainWindow(PolygonBuilder *polygonBuilder, Triangulation *triangulat
   buttonsLayout->addWidget(zoomPB);
   resetViewPB = new QPushButton("Reset view");
   buttonsLayout->addWidget(resetViewPB);
+  importPB = new QPushButton("Import...");
+  buttonsLayout->addWidget(importPB);
+  statusL = new QLabel();
+  buttonsLayout->addWidget(statusL, 1);
 
   mainLayout->addLayout(buttonsLayout);
 
@@ -30,6 +41,9 @@ MainWindow::MainWindow(PolygonBuilder *polygonBuilder, Triangulation *triangulat
   setWindowTitle("Ear clipping demo");
 
   paintArea->setMinimumSize(512, 512);
+  paintArea->addPaintLayer([dataset](QPainter &p, const QTransform &t) {
+    dataset->draw(p, t);
+  });
   paintArea->addPaintLayer([polygonBuilder](QPainter &p, const QTransform &t) {
     polygonBuilder->draw(p, t);
   });
@@ -40,20 +54,45 @@ MainWindow::MainWindow(PolygonBuilder *polygonBuilder, Triangulation *triangulat
 
   connect(resetPB, SIGNAL(clicked()), polygonBuilder, SLOT(reset()));
   connect(resetPB, SIGNAL(clicked()), triangulation, SLOT(reset()));
+  connect(resetPB, SIGNAL(clicked()), paintArea, SLOT(invalidate()));
   connect(resetPB, SIGNAL(clicked()), paintArea, SLOT(resetView()));
 
   connect(completePB, SIGNAL(clicked()), polygonBuilder, SLOT(completeShell()));
   connect(paintArea, &PaintArea::newPoint, polygonBuilder, &PolygonBuilder::addPoint);
 
+  // Live preview: each change schedules a triangulation, which cancels the previous one
+  previewTimer = new QTimer(this);
+  previewTimer->setSingleShot(true);
+  previewTimer->setInterval(PREVIEW_DELAY_MS);
+  connect(polygonBuilder, SIGNAL(changed()), previewTimer, SLOT(start()));
+  connect(previewTimer, &QTimer::timeout, triangulation, [=]() {
+    triangulation->setRing(polygonBuilder->getPreviewRing());
+  });
+
   connect(triangulatePB, &QPushButton::clicked, triangulation, [=]() {
+    previewTimer->stop();
     triangulation->setRing(polygonBuilder->getRing());
-    triangulation->start();
   });
 
-  connect(polygonBuilder, SIGNAL(changed()), paintArea, SLOT(update()));
-  connect(triangulation, SIGNAL(finished()), paintArea, SLOT(update()));
-  connect(triangulation, &Triangulation::finished, this, [&]() {
-    triangulatePB->setEnabled(false);
+  connect(polygonBuilder, SIGNAL(changed()), paintArea, SLOT(invalidate()));
+  connect(triangulation, SIGNAL(triangulated()), paintArea, SLOT(invalidate()));
+  connect(triangulation, &Triangulation::triangulated, this, [=]() {
+    if (polygonBuilder->getState().first == PolygonBuilder::Stage::ShellCompleted)
+      triangulatePB->setEnabled(false);
+
+    auto snapshot = triangulation->getSnapshot();
+    if (!snapshot)
+      return;
+
+    if (snapshot->error) {
+      statusL->setText(QString("Error: %1").arg(snapshot->error->c_str()));
+    } else {
+      auto ms = [](std::chrono::nanoseconds d) { return std::chrono::duration<double, std::milli>(d).count(); };
+      statusL->setText(QString("%1 triangles, %2 ms(clip %3 ms)")
+                           .arg(snapshot->trianglesCount)
+                           .arg(ms(snapshot->latency), 0, 'f', 1)
+                           .arg(ms(snapshot->stats.clipTime), 0, 'f', 1));
+    }
   });
   connect(polygonBuilder, &PolygonBuilder::stateChanged, this, &MainWindow::updateState);
 
@@ -63,15 +102,30 @@ MainWindow::MainWindow(PolygonBuilder *polygonBuilder, Triangulation *triangulat
   });
   connect(resetViewPB, SIGNAL(clicked()), paintArea, SLOT(resetView()));
 
-  updateState(polygonBuilder->getState());
-
-  connect(triangulation, &QThread::finished, this, [=]() {
-    if (auto error = triangulation->getError()) {
-      QMessageBox messageBox;
-      messageBox.setText(error->c_str());
-      messageBox.exec();
+  // Large datasets: loaded in background, only the polygons in view are triangulated
+  connect(importPB, &QPushButton::clicked, dataset, [=]() {
+    auto path = QFileDialog::getOpenFileName(this, "Import polygons", {},
+                                             "Polygons (*.wkt *.txt *.bin);;All files (*)");
+    if (!path.isEmpty())
+      dataset->load(path);
+  });
+  connect(dataset, &Dataset::progress, statusL, [=](int percent) {
+    statusL->setText(QString("Loading: %1%").arg(percent));
+  });
+  connect(dataset, &Dataset::loaded, paintArea, [=]() {
+    auto data = dataset->getData();
+    if (auto error = dataset->getError()) {
+      statusL->setText(QString("Error: %1").arg(*error));
+    } else if (data) {
+      statusL->setText(QString("%1 polygons").arg(data->rings.size()));
+      paintArea->setBBox(data->bBox);
     }
   });
+  connect(paintArea, &PaintArea::viewChanged, dataset, &Dataset::triangulateVisible);
+  connect(dataset, SIGNAL(triangulated()), paintArea, SLOT(invalidate()));
+
+  updateState(polygonBuilder->getState());
+  previewTimer->start();
 }
 
 void MainWindow::updateState(PolygonBuilder::State state) {
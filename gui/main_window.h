@@ -1,17 +1,20 @@
 #pragma once
 
+#include "dataset.h"
 #include "paint_area.h"
 #include "polygon_builder.h"
 #include "triangulation.h"
 
 #include <QWidget>
+#include <QLabel>
 #include <QPushButton>
+#include <QTimer>
 
 class MainWindow : public QWidget {
  Q_OBJECT
 
  public:
-  MainWindow(PolygonBuilder *builder, Triangulation *triangulation, QWidget *p = nullptr);
+  MainWindow(PolygonBuilder *builder, Triangulation *triangulation, Dataset *dataset, QWidget *p = nullptr);
 
  public slots:
   void updateState(PolygonBuilder::State);
@@ -23,5 +26,8 @@ class MainWindow : public QWidget {
   QPushButton *triangulatePB;
   QPushButton *zoomPB;
   QPushButton *resetViewPB;
+  QPushButton *importPB;
+  QLabel *statusL;
+  QTimer *previewTimer;
   PolygonBuilder *polygonBuilder;
 };
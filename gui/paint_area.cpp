@@ -2,23 +2,79 @@
 
 #include <QPainter>
 #include <QMouseEvent>
+#include <QWheelEvent>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// The view bbox gets the margins
+constexpr double MARGIN = 0.025;
+constexpr double ZOOM_STEP = 1.25; // per wheel notch
+
+// One bit per viewport cell of cell x cell pixels
+class PixelMask {
+ public:
+  PixelMask(const QRect &viewport, int cell)
+      : viewport(viewport), cell(std::max(cell, 1)),
+        width(viewport.width() / this->cell + 1), height(viewport.height() / this->cell + 1),
+        bits(static_cast<size_t>(width) * height) {}
+
+  // Returns false if the cell is outside or it's already taken
+  bool take(QPointF p) {
+    if (p.x() < viewport.left() || p.y() < viewport.top())
+      return false;
+    auto x = static_cast<int>(p.x() - viewport.left()) / cell;
+    auto y = static_cast<int>(p.y() - viewport.top()) / cell;
+    if (x >= width || y >= height)
+      return false;
+
+    auto bit = bits.begin() + static_cast<size_t>(y) * width + x;
+    if (*bit)
+      return false;
+    *bit = true;
+    return true;
+  }
+
+ private:
+  QRect viewport;
+  int cell;
+  int width, height;
+  std::vector<bool> bits;
+};
+
+} // namespace
 
 void PaintArea::paintEvent(QPaintEvent *event) {
   QWidget::paintEvent(event);
-  QPalette p(palette());
-  p.setColor(QPalette::Background, Qt::white);
-  setAutoFillBackground(true);
-  setPalette(p);
+
+  auto ratio = devicePixelRatioF();
+  if (cache.isNull() || cache.size() != size() * ratio) {
+    cache = QPixmap(size() * ratio);
+    cache.setDevicePixelRatio(ratio);
+    cache.fill(Qt::white);
+
+    QPainter painter(&cache);
+    auto transform = viewTransform();
+    for (auto &h : paintHandlers)
+      h(painter, transform);
+  }
+
   QPainter painter(this);
+  painter.drawPixmap(0, 0, cache);
+}
 
+QTransform PaintArea::viewTransform() const {
   QTransform transform;
   if (!bBox.isEmpty()) {
-    auto viewport = painter.viewport();
+    auto viewport = rect();
     auto extendedBbox = bBox.marginsAdded(QMarginsF(
-        bBox.width() * 0.025,
-        bBox.height() * 0.025,
-        bBox.width() * 0.025,
-        bBox.height() * 0.025));
+        bBox.width() * MARGIN,
+        bBox.height() * MARGIN,
+        bBox.width() * MARGIN,
+        bBox.height() * MARGIN));
     double scale = std::min(
         viewport.width() / extendedBbox.width(),
         viewport.height() / extendedBbox.height());
@@ -27,28 +83,117 @@ void PaintArea::paintEvent(QPaintEvent *event) {
         .translate(-extendedBbox.left(), -extendedBbox.top());
   }
 
-  for (auto &h : paintHandlers)
-    h(painter, transform);
+  return transform;
 }
 
 PaintArea::PaintArea(QWidget *p)
-    : QWidget(p) {}
+    : QWidget(p) {
+  QPalette palette(this->palette());
+  palette.setColor(QPalette::Background, Qt::white);
+  setAutoFillBackground(true);
+  setPalette(palette);
+}
 
 void PaintArea::addPaintLayer(PaintArea::PaintHandler handler) {
   paintHandlers.push_back(std::move(handler));
+  invalidate();
+}
+
+void PaintArea::resizeEvent(QResizeEvent *event) {
+  QWidget::resizeEvent(event);
+  emit viewChanged(visibleRect());
+}
+
+void PaintArea::mousePressEvent(QMouseEvent *event) {
+  QWidget::mousePressEvent(event);
+  if (event->button() == Qt::RightButton)
+    panFrom = event->pos();
+}
+
+void PaintArea::mouseMoveEvent(QMouseEvent *event) {
+  QWidget::mouseMoveEvent(event);
+  if (!(event->buttons() & Qt::RightButton))
+    return;
+
+  auto inverted = viewTransform().inverted();
+  auto shift = inverted.map(QPointF(event->pos())) - inverted.map(QPointF(panFrom));
+  panFrom = event->pos();
+  bBox = viewBBox().translated(-shift);
+  changeView();
 }
 
 void PaintArea::mouseReleaseEvent(QMouseEvent *event) {
   QWidget::mouseReleaseEvent(event);
-  emit newPoint({event->x(), event->y()});
+  if (event->button() == Qt::LeftButton)
+    emit newPoint({event->x(), event->y()});
+}
+
+void PaintArea::wheelEvent(QWheelEvent *event) {
+  QWidget::wheelEvent(event);
+  auto factor = std::pow(ZOOM_STEP, -event->angleDelta().y() / 120.0);
+  auto center = viewTransform().inverted().map(event->posF());
+  auto view = viewBBox();
+  bBox = QRectF(center + (view.topLeft() - center) * factor, view.size() * factor);
+  changeView();
+}
+
+PaintArea::BBox PaintArea::visibleRect() const {
+  return viewTransform().inverted().mapRect(QRectF(rect()));
+}
+
+PaintArea::BBox PaintArea::viewBBox() const {
+  auto visible = visibleRect();
+  auto size = visible.size() / (1 + 2 * MARGIN);
+  return QRectF(visible.center() - QPointF(size.width(), size.height()) / 2, size);
 }
 
 void PaintArea::setBBox(PaintArea::BBox newBBox) {
   bBox = newBBox;
+  changeView();
 }
 
 void PaintArea::resetView() {
   bBox = QRectF();
+  changeView();
+}
+
+void PaintArea::changeView() {
+  invalidate();
+  emit viewChanged(visibleRect());
+}
+
+void PaintArea::invalidate() {
+  cache = QPixmap();
   update();
 }
 
+QVector<QPointF> visiblePoints(const QVector<QPointF> &points, const QTransform &transform, const QRect &viewport,
+                               int cell) {
+  PixelMask mask(viewport, cell);
+  QVector<QPointF> result;
+  for (auto p : points) {
+    auto mapped = transform.map(p);
+    if (mask.take(mapped))
+      result.push_back(mapped);
+  }
+
+  return result;
+}
+
+QVector<QLineF> visibleLines(const QVector<QLineF> &lines, const QTransform &transform, const QRect &viewport) {
+  PixelMask mask(viewport, 1);
+  QRectF bounds(viewport);
+  QVector<QLineF> result;
+  for (const auto &l : lines) {
+    auto mapped = transform.map(l);
+    if (std::max(mapped.x1(), mapped.x2()) < bounds.left() || std::min(mapped.x1(), mapped.x2()) > bounds.right() ||
+        std::max(mapped.y1(), mapped.y2()) < bounds.top() || std::min(mapped.y1(), mapped.y2()) > bounds.bottom())
+      continue;
+
+    if (std::abs(mapped.dx()) < 1 && std::abs(mapped.dy()) < 1 && !mask.take(mapped.p1()))
+      continue;
+    result.push_back(mapped);
+  }
+
+  return result;
+}
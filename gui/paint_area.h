@@ -2,6 +2,7 @@
 
 #include "polygon_builder.h"
 
+#include <QPixmap>
 #include <QWidget>
 #include <functional>
 
@@ -15,19 +16,44 @@ class PaintArea : public QWidget {
   explicit PaintArea(QWidget *p = nullptr);
   void addPaintLayer(PaintHandler handler);
   void setBBox(BBox bbox);
+  // The part of the layers coordinates space in view
+  BBox visibleRect() const;
 
  signals:
   void newPoint(QPoint point);
+  void viewChanged(QRectF visible);
 
  public slots:
   void resetView();
+  // The layers data is changed, they are painted again on the next update
+  void invalidate();
 
  protected:
   void paintEvent(QPaintEvent *event) final;
+  void resizeEvent(QResizeEvent *event) override;
+  // Left click - a new point, right drag - pan, wheel - zoom
+  void mousePressEvent(QMouseEvent *event) override;
+  void mouseMoveEvent(QMouseEvent *event) override;
   void mouseReleaseEvent(QMouseEvent *event) override;
+  void wheelEvent(QWheelEvent *event) override;
 
  private:
+  QTransform viewTransform() const;
+  // The bbox which shows the visible rect(the same view, but with a bbox)
+  BBox viewBBox() const;
+  void changeView();
+
   std::vector<PaintHandler> paintHandlers;
   std::vector<ClickHandler> clickHandlers;
   BBox bBox;
+  QPoint panFrom;
+  QPixmap cache; // all the layers, null - to be painted
 };
+
+// Level of detail helpers for the layers: the items are transformed to the
+// device, the ones outside of the viewport are culled and no more than one
+// point is kept per cell x cell pixels.
+QVector<QPointF> visiblePoints(const QVector<QPointF> &points, const QTransform &transform, const QRect &viewport,
+                               int cell = 1);
+// Lines shorter than a pixel are kept only if their pixel isn't taken yet
+QVector<QLineF> visibleLines(const QVector<QLineF> &lines, const QTransform &transform, const QRect &viewport);
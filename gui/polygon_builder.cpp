@@ -1,4 +1,5 @@
 #include "polygon_builder.h"
+#include "paint_area.h"
 
 #include <QPolygon>
 
@@ -39,8 +40,9 @@ void PolygonBuilder::draw(QPainter &painter, const QTransform &transform) {
   auto shellTransformed = transform.map(shell);
   painter.drawPolyline(shellTransformed);
 
-  painter.setPen(QPen(Qt::black, 10, Qt::SolidLine, Qt::RoundCap));
-  painter.drawPoints(shellTransformed);
+  constexpr int POINT_SIZE = 10;
+  painter.setPen(QPen(Qt::black, POINT_SIZE, Qt::SolidLine, Qt::RoundCap));
+  painter.drawPoints(visiblePoints(shell, transform, painter.viewport(), POINT_SIZE / 2));
 }
 
 void PolygonBuilder::completeShell() {
@@ -61,6 +63,13 @@ PolygonBuilder::Ring PolygonBuilder::getRing() const {
   return result;
 }
 
+PolygonBuilder::Ring PolygonBuilder::getPreviewRing() const {
+  if (state.first != Stage::ShellCompleted)
+    return shell;
+
+  return getRing();
+}
+
 void PolygonBuilder::setState(State newState) {
   if (state != newState) {
     emit stateChanged(newState);
@@ -34,6 +34,8 @@ class PolygonBuilder : public QObject {
   void reset();
   void completeShell();
   Ring getRing() const;
+  // The shell so far, it's implicitly closed while it's drawn
+  Ring getPreviewRing() const;
 
  signals:
   void changed();
@@ -1,65 +1,147 @@
 #include "triangulation.h"
+#include "paint_area.h"
 
-void Triangulation::run() {
-  ear_clip::Ring polygon;
+#include <algorithm>
+#include <vector>
+
+Triangulation::Triangulation() {
+  start();
+}
+
+Triangulation::~Triangulation() {
   {
-    auto ring = ring_;
-    if (!ring) {
-      return;
+    QMutexLocker lock(&mutex);
+    stopping = true;
+    cancel = true;
+    jobReady.wakeOne();
+  }
+  wait();
+}
+
+void Triangulation::run() {
+  while (true) {
+    std::shared_ptr<Ring> ring;
+    uint64_t job;
+    std::chrono::steady_clock::time_point started;
+    {
+      QMutexLocker lock(&mutex);
+      while (!stopping && !ring_)
+        jobReady.wait(&mutex);
+      if (stopping)
+        return;
+
+      ring = std::move(ring_);
+      job = generation;
+      started = ringTime;
+      cancel = false;
     }
 
+    ear_clip::Ring polygon;
     for (auto p : *ring) {
       polygon.push_back({p.x(), p.y()});
     }
-  }
 
-  std::vector<ear_clip::Triangle> triangulation;
-  try {
-    ear_clip::enableTrace(true);
-    triangulation = ear_clip::triangulate(std::move(polygon));
-    error = std::nullopt;
-  }
-  catch (const std::exception &e) {
-    error = e.what();
-  }
+    auto newSnapshot = std::make_shared<Snapshot>();
+    newSnapshot->generation = job;
+    try {
+      ear_clip::Options options;
+      options.stats = &newSnapshot->stats;
+      options.cancel = &cancel;
+      auto triangulation = ear_clip::triangulate(std::move(polygon), options);
+      newSnapshot->trianglesCount = static_cast<int>(triangulation.size());
+
+      // Inner edges are shared by two triangles
+      std::vector<std::pair<ear_clip::Point, ear_clip::Point>> edges;
+      std::vector<ear_clip::Point> points;
+      edges.reserve(triangulation.size() * 3);
+      points.reserve(triangulation.size() * 3);
+      for (const auto &t : triangulation) {
+        for (size_t i = 0; i < 3; ++i) {
+          auto a = t[i], b = t[(i + 1) % 3];
+          edges.push_back(b < a ? std::make_pair(b, a) : std::make_pair(a, b));
+          points.push_back(a);
+        }
+      }
+      std::sort(edges.begin(), edges.end());
+      edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+      std::sort(points.begin(), points.end());
+      points.erase(std::unique(points.begin(), points.end()), points.end());
 
-  auto newTriangles = std::make_shared<QVector<Triangle>>();
-  for (const auto &t : triangulation) {
-    newTriangles->push_back({{t[0].x, t[0].y},
-                             {t[1].x, t[1].y},
-                             {t[2].x, t[2].y},
-                             {t[0].x, t[0].y}});
+      newSnapshot->edges.reserve(static_cast<int>(edges.size()));
+      for (const auto &[a, b] : edges)
+        newSnapshot->edges.push_back({a.x, a.y, b.x, b.y});
+      newSnapshot->points.reserve(static_cast<int>(points.size()));
+      for (const auto &p : points)
+        newSnapshot->points.push_back({p.x, p.y});
+    }
+    catch (const ear_clip::Cancelled &) {
+      continue;
+    }
+    catch (const std::exception &e) {
+      newSnapshot->error = e.what();
+    }
+
+    if (job != generation)
+      continue;
+
+    newSnapshot->latency = std::chrono::steady_clock::now() - started;
+    if (publish(std::move(newSnapshot)))
+      emit triangulated();
   }
+}
+
+bool Triangulation::publish(std::shared_ptr<const Snapshot> newSnapshot) {
+  auto current = std::atomic_load(&snapshot);
+  do {
+    if (current && current->generation > newSnapshot->generation)
+      return false;
+  } while (!std::atomic_compare_exchange_weak(&snapshot, &current, newSnapshot));
 
-  triangles = newTriangles;
+  return true;
 }
 
 void Triangulation::draw(QPainter &painter, const QTransform &transform) {
-  auto ts = triangles;
-  if (!ts)
+  auto s = getSnapshot();
+  if (!s)
     return;
 
-  for (const auto &t : *ts) {
-    const auto transformed = transform.map(t);
-    painter.setPen(QPen(Qt::green, 2, Qt::SolidLine, Qt::RoundCap));
-    painter.drawPolyline(transformed);
-    painter.setPen(QPen(Qt::red, 5, Qt::SolidLine, Qt::RoundCap));
-    painter.drawPoints(transformed);
-  }
+  auto viewport = painter.viewport();
+  painter.setPen(QPen(Qt::green, 2, Qt::SolidLine, Qt::RoundCap));
+  painter.drawLines(visibleLines(s->edges, transform, viewport));
+  constexpr int POINT_SIZE = 5;
+  painter.setPen(QPen(Qt::red, POINT_SIZE, Qt::SolidLine, Qt::RoundCap));
+  painter.drawPoints(visiblePoints(s->points, transform, viewport, POINT_SIZE / 2));
 }
 
 void Triangulation::reset() {
-  triangles.reset();
-  ring_.reset();
-  error = std::nullopt;
+  uint64_t resetGeneration;
+  {
+    QMutexLocker lock(&mutex);
+    ring_.reset();
+    resetGeneration = ++generation;
+    cancel = true;
+  }
+
+  auto empty = std::make_shared<Snapshot>();
+  empty->generation = resetGeneration;
+  publish(std::move(empty));
 }
 
 void Triangulation::setRing(Triangulation::Ring newPolygon) {
-  auto polygon = std::make_shared<Ring>();
-  *polygon = std::move(newPolygon);
-  ring_ = polygon;
+  auto polygon = std::make_shared<Ring>(std::move(newPolygon));
+  QMutexLocker lock(&mutex);
+  ring_ = std::move(polygon);
+  ringTime = std::chrono::steady_clock::now();
+  ++generation;
+  cancel = true;
+  jobReady.wakeOne();
+}
+
+std::shared_ptr<const Triangulation::Snapshot> Triangulation::getSnapshot() const {
+  return std::atomic_load(&snapshot);
 }
 
 std::optional<std::string> Triangulation::getError() const {
-  return error;
+  auto s = getSnapshot();
+  return s ? s->error : std::nullopt;
 }
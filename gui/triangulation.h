@@ -2,29 +2,68 @@
 
 #include "ear_clip.h"
 
+#include <QMutex>
 #include <QThread>
 #include <QPainter>
+#include <QWaitCondition>
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 
+// A persistent worker thread, which triangulates the last given ring. A new
+// ring cancels the job in progress, results are published without blocking
+// the UI thread.
 class Triangulation : public QThread {
  Q_OBJECT
  public:
   using Point = QPointF;
-  using Triangle = QVector<Point>;
   using Ring = QVector<Point>;
+
+  // An immutable published result. Readers hold it by a shared pointer, so
+  // they always see a consistent one without waiting for the worker.
+  struct Snapshot {
+    uint64_t generation = 0; // of the ring(or reset) it's made for
+    int trianglesCount = 0;
+    // Batched for drawing: each edge and vertex once
+    QVector<QLineF> edges;
+    QVector<Point> points;
+    std::optional<std::string> error;
+    ear_clip::TriangulationStats stats;
+    std::chrono::nanoseconds latency{}; // from setRing() to the publication
+  };
+
+  Triangulation();
+  ~Triangulation() override;
+
   void draw(QPainter &painter, const QTransform &transform);
+  // Schedules the ring triangulation
   void setRing(Ring newPolygon);
+  // The latest result, nullptr if there is nothing yet
+  std::shared_ptr<const Snapshot> getSnapshot() const;
   std::optional<std::string> getError() const;
 
  public slots:
   void reset();
 
+ signals:
+  // A new snapshot is published, it's emitted from the worker thread
+  void triangulated();
+
  private:
   void run() final;
+  // Replaces the snapshot unless a newer generation is already published
+  bool publish(std::shared_ptr<const Snapshot> newSnapshot);
 
  private:
-  std::shared_ptr<QVector<Triangle>> triangles;
+  QMutex mutex;
+  QWaitCondition jobReady;
+  // guarded by the mutex
   std::shared_ptr<Ring> ring_;
-  std::optional<std::string> error;
-};
\ No newline at end of file
+  std::chrono::steady_clock::time_point ringTime;
+  bool stopping = false;
+
+  std::atomic<uint64_t> generation{0}; // each ring and reset make the jobs in progress stale
+  std::atomic<bool> cancel{false};
+  std::shared_ptr<const Snapshot> snapshot; // only accessed by the std::atomic_* functions
+};
@@ -1,15 +1,82 @@
-#include <iostream>
 #include <algorithm>
 #include <map>
 #include <tuple>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <thread>
 
+#include "async.h"
+#include "batch.h"
+#include "delaunay.h"
 #include "ear_clip.h"
+#include "incremental.h"
+#include "intersection_search.h"
+#include "mesh_order.h"
+#include "planar_graph.h"
+#include "point_locator.h"
+#include "point_welder.h"
+#include "simplify.h"
+#include "tiles.h"
+#include "verify.h"
 
 namespace ec = ear_clip;
 namespace ecd = ear_clip::details;
 
+namespace {
+// Heap allocations through the global operator new are counted while it's set
+bool countHeapAllocations = false;
+size_t heapAllocations = 0;
+
+// Out of line: GCC pairs an inlined free() with the operator new of the
+// call site and warns(-Wmismatched-new-delete), though both are ours
+[[gnu::noinline]] void release(void *p) noexcept {
+  std::free(p);
+}
+}
+
+void *operator new(size_t size) {
+  if (countHeapAllocations)
+    heapAllocations++;
+  if (auto p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+  release(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  release(p);
+}
+
+// std::pmr::new_delete_resource() uses the aligned versions
+void *operator new(size_t size, std::align_val_t alignment) {
+  if (countHeapAllocations)
+    heapAllocations++;
+  auto align = static_cast<size_t>(alignment);
+  if (auto p = std::aligned_alloc(align, (size + align - 1) / align * align))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+  release(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  release(p);
+}
+
 inline std::ostream &operator<<(std::ostream &s, ecd::VertexOrder direction) {
   static const std::map<ecd::VertexOrder, std::string> DIRS = {
       {ecd::VertexOrder::CLOCKWISE, "Clockwise"},
@@ -44,7 +111,7 @@ inline std::ostream &operator<<(std::ostream &s, const ec::Ring &r) {
   return s;
 }
 
-inline std::ostream &operator<<(std::ostream &s, const std::vector<ec::Triangle> &r) {
+inline std::ostream &operator<<(std::ostream &s, const ec::Triangles &r) {
   s << "{";
   bool putComma = false;
   for (const auto &p : r) {
@@ -89,7 +156,7 @@ bool expectEqual(ec::Triangle a, ec::Triangle b) {
   return equal;
 }
 
-bool expectEqual(std::vector<ec::Triangle> a, std::vector<ec::Triangle> b) {
+bool expectEqual(ec::Triangles a, ec::Triangles b) {
   if (a.size() != b.size()) {
     std::cout << "Test failed: " << a << " != " << b << '\n';
     return false;
@@ -141,7 +208,7 @@ bool testRingRotation(ec::Ring r, ecd::VertexOrder dir_tar) {
 }
 
 bool testTriangulate(const ec::Ring &r,
-                     const std::vector<ec::Triangle> &expected, const std::string &name) {
+                     const ec::Triangles &expected, const std::string &name) {
   std::cout << "Test triangulation. " << name << ": ";
   auto ts = ec::triangulate(r);
   bool ok = expectEqual(ts, expected);
@@ -248,9 +315,1062 @@ size_t testPointInTriangle() {
   return failedCount;
 }
 
-int main() {
+bool testStats(const ec::Ring &r, size_t expectedSplitPoints, const std::string &name) {
+  std::cout << "Test stats. " << name << ": ";
+  ec::TriangulationStats stats;
+  ec::Options options;
+  options.stats = &stats;
+  auto ts = ec::triangulate(r, options);
+  bool ok = expectEqual(ts, ec::triangulate(r));
+  ok &= stats.splitPoints == expectedSplitPoints;
+  ok &= stats.pointInTriangleCalls > 0;
+  ok &= stats.counterResets >= ts.size();
+  ok &= stats.allocations > 0;
+  ok &= stats.allocatedBytes >= ts.capacity() * sizeof(ec::Triangle);
+  ok &= stats.peakBytes > 0 && stats.peakBytes <= stats.allocatedBytes;
+  std::cout << (ok ? "OK" : "Failed") << '\n';
+  if (!ok)
+    std::cout << "Split points: " << stats.splitPoints << ", point in triangle calls: " << stats.pointInTriangleCalls
+              << ", counter resets: " << stats.counterResets << ", allocations: " << stats.allocations
+              << ", bytes: " << stats.allocatedBytes << ", peak bytes: " << stats.peakBytes << '\n';
+
+  return !ok;
+}
+
+// A std::list ring(the earlier API) gets the same triangles in a std::vector
+bool testStdContainers(const ec::Ring &r, const std::string &name) {
+  std::cout << "Test std containers. " << name << ": ";
+  std::list<ec::Point> ring(r.begin(), r.end());
+  std::vector<ec::Triangle> ts = ec::triangulate(ring);
+  auto expected = ec::triangulate(r);
+  bool ok = std::equal(ts.begin(), ts.end(), expected.begin(), expected.end());
+  std::cout << (ok ? "OK" : "Failed") << '\n';
+
+  return !ok;
+}
+
+size_t testPointWelder() {
+  std::cout << "Test point welder: ";
+  size_t failedCount = 0;
+  auto expect = [&failedCount](bool ok, const std::string &name) {
+    if (!ok) {
+      std::cout << name << ": Failed ";
+      failedCount++;
+    }
+  };
+
+  ecd::PointWelder exact;
+  expect(exact.weld({0, 0}) == 0, "first id");
+  expect(exact.weld({1, 0}) == 1, "second id");
+  expect(exact.weld({-0.0, 0}) == 0, "negative zero");
+  expect(exact.weld({1, 1e-12}) == 2, "exact near point");
+  expect(exact.find({5, 5}) == ecd::PointWelder::NO_ID, "missing point");
+  for (int i = 0; i < 1000; ++i)
+    exact.weld({double(i), double(-i)});
+  expect(exact.size() == 1002, "rehash");
+  expect(exact.find({999, -999}) == 1001 && exact.find({1, 1e-12}) == 2, "find after rehash");
+
+  ecd::PointWelder snapping(0.001);
+  expect(snapping.weld({0.9999, 0}) == 0, "snap first id");
+  expect(snapping.weld({1.0005, 0}) == 0, "snap across cells");
+  expect(snapping.weld({1.0015, 0}) == 1, "snap out of tolerance");
+  expect(snapping.points()[0].x == 0.9999, "snap keeps the first point");
+
+  if (failedCount == 0) {
+    std::cout << "Ok\n";
+  } else {
+    std::cout << "Failed\n";
+  }
+
+  return failedCount;
+}
+
+size_t testClockwiseOrder() {
+  std::cout << "Test clockwise order: ";
+  const ec::Point west{-1, 0}, north{0, 1}, east{1, 0}, south{0, -1}, northWest{-1, 1};
+  // The rounded cross product of these is 0, the exact one is -epsilon^2
+  const double epsilon = std::numeric_limits<double>::epsilon();
+  const ec::Point nearlyNorthEast{1 + epsilon, 1}, northEast{1, 1 - epsilon};
+  const std::vector<std::tuple<ec::Point, ec::Point, ec::Point, bool>> CASES{
+      {west, west, north, true},
+      {west, north, west, false},
+      {west, northWest, north, true},
+      {west, north, east, true},
+      {west, east, south, true},
+      {west, south, west, false},
+      {east, south, west, true},
+      {east, north, south, false},
+      {west, {-2, 0}, west, false},
+      {west, nearlyNorthEast, northEast, true},
+      {west, northEast, nearlyNorthEast, false},
+  };
+  size_t failedCount = 0;
+  for (size_t i = 0; i < CASES.size(); ++i) {
+    auto [reference, l, r, expected] = CASES[i];
+    bool failed = ecd::clockwiseLess(reference, l, r) != expected;
+    failedCount += failed;
+    if (failed)
+      std::cout << "Test clockwise order test case# " << i << ": Failed\n";
+  }
+
+  if (failedCount == 0) {
+    std::cout << "Ok\n";
+  } else {
+    std::cout << "Failed\n";
+  }
+
+  return failedCount;
+}
+
+bool testPlanarGraphFaces(const std::pmr::vector<ec::Point> &nodes,
+                          const std::vector<std::pair<size_t, size_t>> &edges,
+                          size_t expectedFaces, const std::string &name) {
+  std::cout << "Test planar graph faces. " << name << ": ";
+  ecd::PlanarGraph::Edges graphEdges;
+  for (auto e : edges)
+    graphEdges.emplace_back(e);
+  graphEdges.emplace_back(std::nullopt); // removed edges are skipped
+  ecd::PlanarGraph graph(nodes, graphEdges);
+
+  auto faces = graph.faces();
+  bool ok = faces.size() == expectedFaces;
+  size_t faceEdges = 0;
+  for (const auto &face : faces) {
+    ec::Ring ring;
+    for (auto id : face)
+      ring.push_back(nodes[id]);
+    faceEdges += face.size();
+    ok &= ecd::vertexOrder(ring) == ecd::VertexOrder::C_CLOCKWISE;
+  }
+  for (size_t node = 0; node < graph.nodesCount(); ++node) {
+    for (const auto &halfEdge : graph.halfEdges(node))
+      ok &= graph.halfEdge(halfEdge.twin).to == node;
+  }
+  std::cout << (ok ? "Ok" : "Failed") << '\n';
+  if (!ok)
+    std::cout << "Faces: " << faces.size() << ", face edges: " << faceEdges << '\n';
+
+  return !ok;
+}
+
+bool testNormalizeSnapping(ec::Ring ring, double tolerance, const ec::Ring &expected) {
+  std::cout << "Test normalize with snapping " << tolerance << ": " << ring << ": ";
+  ec::Options options;
+  options.snapTolerance = tolerance;
+  ring = ecd::normalizeRing(std::move(ring), options);
+  bool ok = expectEqual(ring, expected);
+  std::cout << (ok ? "Ok" : "Failed") << '\n';
+  if (!ok)
+    std::cout << "Expected: " << expected << '\n' << "But got " << ring << '\n';
+
+  return !ok;
+}
+
+double area(const ec::Triangles &ts) {
+  double result = 0;
+  for (const auto &t : ts)
+    result += std::abs((t[1].x - t[0].x) * (t[2].y - t[0].y) - (t[2].x - t[0].x) * (t[1].y - t[0].y)) / 2;
+  return result;
+}
+
+bool testFaces(const ec::Ring &r, ec::FillRule rule, std::vector<size_t> expectedSizes, const std::string &name) {
+  std::cout << "Test faces. " << name << ": ";
+  auto faces = ecd::normalizeFaces(r, rule);
+  std::vector<size_t> sizes;
+  for (const auto &face : faces)
+    sizes.push_back(face.size());
+  std::sort(sizes.begin(), sizes.end());
+  std::sort(expectedSizes.begin(), expectedSizes.end());
+  bool ok = sizes == expectedSizes;
+  std::cout << (ok ? "Ok" : "Failed") << '\n';
+  if (!ok) {
+    for (const auto &face : faces)
+      std::cout << face << '\n';
+  }
+
+  return !ok;
+}
+
+bool testTriangulateFaces(const ec::Ring &r, ec::FillRule rule, double expectedArea, const std::string &name) {
+  std::cout << "Test triangulation of faces. " << name << ": ";
+  ec::Options options;
+  options.fillRule = rule;
+  options.threads = 1;
+  auto serial = ec::triangulate(r, options);
+  options.threads = 4;
+  auto parallel = ec::triangulate(r, options);
+  bool ok = expectEqual(area(serial), expectedArea) && expectEqual(serial, parallel);
+  std::cout << (ok ? "OK" : "Failed") << '\n';
+  if (!ok)
+    std::cout << "Serial: " << serial << '\n' << "Parallel: " << parallel << '\n';
+
+  return !ok;
+}
+
+double area(const ec::Ring &r) {
+  double result = 0;
+  for (auto i = r.begin(), j = std::prev(r.end()); i != r.end(); j = i++)
+    result += j->x * i->y - i->x * j->y;
+  return std::abs(result) / 2;
+}
+
+// Random edits of a circle, each must give the same area as the full triangulation
+size_t testIncremental() {
+  std::cout << "Test incremental triangulation: ";
+  std::mt19937 random(42);
+  std::uniform_real_distribution<double> offset(-0.005, 0.005);
+  constexpr size_t VERTICES = 200;
+  ec::Ring circle;
+  for (size_t i = 0; i < VERTICES; ++i) {
+    auto angle = 2 * M_PI * i / VERTICES;
+    circle.push_back({std::cos(angle), std::sin(angle)});
+  }
+
+  ec::IncrementalTriangulation triangulation(circle);
+  size_t failed = 0;
+  auto check = [&](const char *edit) {
+    auto ring = triangulation.ring();
+    if (!expectEqual(area(triangulation.triangles()), area(ec::triangulate(ring)))) {
+      std::cout << edit << " failed\n";
+      ++failed;
+    }
+  };
+
+  for (size_t i = 0; i < 300; ++i) {
+    auto vertex = triangulation.first();
+    for (auto steps = random() % triangulation.size(); steps != 0; --steps)
+      vertex = triangulation.next(vertex);
+    auto p = triangulation.point(vertex);
+    auto q = triangulation.point(triangulation.next(vertex));
+    switch (i % 3) {
+      case 0:
+        triangulation.insert(vertex, {(p.x + q.x) / 2 + offset(random), (p.y + q.y) / 2 + offset(random)});
+        check("Insert");
+        break;
+      case 1:
+        triangulation.move(vertex, {p.x + offset(random), p.y + offset(random)});
+        check("Move");
+        break;
+      default:
+        triangulation.remove(vertex);
+        check("Remove");
+    }
+  }
+
+  // A self intersection, then back to a simple ring
+  auto vertex = triangulation.first();
+  auto p = triangulation.point(vertex);
+  auto rebuilds = triangulation.rebuilds();
+  triangulation.move(vertex, {-p.x * 2, -p.y * 2});
+  check("Self intersection");
+  triangulation.move(vertex, p);
+  check("Simple again");
+  failed += triangulation.rebuilds() != rebuilds + 2;
+
+  // most of the edits must be local
+  failed += triangulation.localUpdates() < 200;
+  std::cout << (failed == 0 ? "OK" : "Failed") << '\n';
+  if (failed != 0)
+    std::cout << "Local updates: " << triangulation.localUpdates() << ", rebuilds: " << triangulation.rebuilds() << '\n';
+
+  return failed;
+}
+
+bool testCancel(const ec::Ring &r, const std::string &name) {
+  std::cout << "Test cancel. " << name << ": ";
+  std::atomic<bool> cancel = true;
+  ec::Options options;
+  options.cancel = &cancel;
+  bool ok = false;
+  try {
+    ec::triangulate(r, options);
+  } catch (const ec::Cancelled &) {
+    ok = true;
+  }
+
+  options.fillRule = ec::FillRule::NON_ZERO;
+  options.threads = 2;
+  try {
+    ec::triangulate(r, options);
+    ok = false;
+  } catch (const ec::Cancelled &) {
+  }
+
+  cancel = false;
+  ec::Options nonZero;
+  nonZero.fillRule = ec::FillRule::NON_ZERO;
+  ok &= ec::triangulate(r, options).size() == ec::triangulate(r, nonZero).size();
+  std::cout << (ok ? "OK" : "Failed") << '\n';
+
+  return !ok;
+}
+
+// The status API must agree with the throwing one
+size_t testStatus(const ec::Ring &r, ec::Status expected, const std::string &name) {
+  std::cout << "Test status. " << name << ": ";
+  size_t failedCount = 0;
+  auto expect = [&failedCount](bool ok, const std::string &name) {
+    if (!ok) {
+      std::cout << name << ": Failed ";
+      failedCount++;
+    }
+  };
+
+  // The ring may be stuck without a fill rule, the faces never are
+  for (auto fillRule : {std::optional<ec::FillRule>(), std::optional(ec::FillRule::NON_ZERO)}) {
+    ec::Options options;
+    options.fillRule = fillRule;
+    auto status = fillRule ? ec::Status::OK : expected;
+    auto result = ec::tryTriangulate(r, options);
+    expect(result.status == status && result.value == ec::triangulate(r, options), "triangles");
+    auto mesh = ec::tryTriangulateMesh(r, options);
+    expect(mesh.status == status && mesh.value.triangles == ec::triangulateMesh(r, options).triangles, "mesh");
+  }
+
+  expect(ec::tryTriangulate({{0, 0}, {1, 0}, {2, 0}, {1, 0}}).status == ec::Status::DEGENERATE, "no area");
+  expect(ec::tryTriangulateMesh({{0, 0}, {1, 0}}).status == ec::Status::DEGENERATE, "no area mesh");
+  // Enough segments for the search grid, whose bounds have no area then
+  ec::Ring line;
+  for (int i = 0; i < 300; ++i)
+    line.push_back({double(i), 0});
+  for (int i = 300; i-- > 1;)
+    line.push_back({double(i), 0});
+  expect(ec::tryTriangulate(line).status == ec::Status::DEGENERATE, "no area line");
+
+  std::atomic<bool> cancel = true;
+  ec::Options options;
+  options.cancel = &cancel;
+  auto cancelled = ec::tryTriangulate(r, options);
+  expect(cancelled.status == ec::Status::CANCELLED && cancelled.value.empty(), "cancel");
+  options.fillRule = ec::FillRule::EVEN_ODD;
+  expect(ec::tryTriangulateMesh(r, options).status == ec::Status::CANCELLED, "cancel mesh");
+
+  options = {};
+  options.snapTolerance = -1;
+  expect(ec::tryTriangulate(r, options).status == ec::Status::INVALID_OPTIONS, "invalid options");
+  bool thrown = false;
+  try {
+    ec::triangulate(r, options);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  expect(thrown, "invalid options throw");
+
+  std::cout << (failedCount == 0 ? "Ok" : "Failed") << '\n';
+  return failedCount;
+}
+
+// Small steps must give the triangulate() result, with the triangles growing on the way
+size_t testTriangulator(const ec::Ring &r, std::optional<ec::FillRule> fillRule, const std::string &name) {
+  std::cout << "Test triangulator. " << name << ": ";
+  size_t failedCount = 0;
+  auto expect = [&failedCount](bool ok, const std::string &name) {
+    if (!ok) {
+      std::cout << name << ": Failed ";
+      failedCount++;
+    }
+  };
+
+  ec::Options options;
+  options.fillRule = fillRule;
+  auto expected = ec::tryTriangulate(r, options);
+
+  ec::Triangulator triangulator(r, options);
+  size_t steps = 0;
+  bool grows = true;
+  while (!triangulator.step(size_t{16})) {
+    auto size = triangulator.triangles().size();
+    steps++;
+    grows &= std::equal(triangulator.triangles().begin(), triangulator.triangles().end(), expected.value.begin(),
+                        expected.value.begin() + static_cast<std::ptrdiff_t>(std::min(size, expected.value.size())));
+  }
+  expect(steps > 1 && grows, "steps");
+  expect(triangulator.status() == expected.status && triangulator.triangles() == expected.value, "result");
+
+  ec::Triangulator timed(r, options);
+  while (!timed.step(std::chrono::microseconds(100))) {
+  }
+  expect(timed.status() == expected.status && timed.triangles() == expected.value, "timed");
+
+  std::atomic<bool> cancel = false;
+  options.cancel = &cancel;
+  ec::Triangulator cancelled(r, options);
+  cancelled.step(size_t{16});
+  cancel = true;
+  cancelled.step(SIZE_MAX);
+  expect(cancelled.done() && cancelled.status() == ec::Status::CANCELLED && cancelled.triangles().empty(), "cancel");
+
+  // Reported by the first step, not raised by the constructor
+  options.cancel = nullptr;
+  options.snapTolerance = -1;
+  ec::Triangulator invalid(r, options);
+  invalid.step(SIZE_MAX);
+  expect(invalid.done() && invalid.status() == ec::Status::INVALID_OPTIONS && invalid.triangles().empty(),
+         "invalid options");
+
+  std::cout << (failedCount == 0 ? "Ok" : "Failed") << '\n';
+  if (failedCount != 0)
+    std::cout << "Steps: " << steps << '\n';
+  return failedCount;
+}
+
+// The tiles must hold the triangulation area, each within its tile
+// coverage - the share of the area the grid covers
+size_t testTiles(const ec::Ring &r, std::optional<ec::FillRule> fillRule, const ec::TileGrid &grid,
+                 size_t expectedTiles, double coverage, const std::string &name) {
+  std::cout << "Test tiles. " << name << ": ";
+  size_t failedCount = 0;
+  auto expect = [&failedCount](bool ok, const std::string &name) {
+    if (!ok) {
+      std::cout << name << ": Failed ";
+      failedCount++;
+    }
+  };
+
+  ec::Options options;
+  options.fillRule = fillRule;
+  auto expectedArea = coverage * area(ec::triangulate(r, options));
+  double tilesArea = 0;
+  bool inside = true, ordered = true;
+  std::pair<size_t, size_t> previous{0, 0};
+  auto tiles = ec::triangulateTiles(r, grid, options);
+  for (const auto &tile : tiles) {
+    ec::Triangles triangles;
+    for (const auto &indices : tile.triangles)
+      triangles.push_back({tile.vertices[indices[0]], tile.vertices[indices[1]], tile.vertices[indices[2]]});
+    tilesArea += area(triangles);
+    auto left = grid.origin.x + double(tile.column) * grid.tileWidth;
+    auto bottom = grid.origin.y + double(tile.row) * grid.tileHeight;
+    for (const auto &p : tile.vertices) {
+      inside &= p.x >= left && p.x <= left + grid.tileWidth && p.y >= bottom && p.y <= bottom + grid.tileHeight;
+    }
+    ordered &= &tile == &tiles.front() || previous < std::make_pair(tile.row, tile.column);
+    previous = {tile.row, tile.column};
+  }
+  expect(tiles.size() == expectedTiles, "tiles");
+  expect(std::abs(tilesArea - expectedArea) <= 1e-9 * expectedArea, "area");
+  expect(inside, "inside");
+  expect(ordered, "ordered");
+
+  options.threads = 4;
+  auto parallel = ec::triangulateTiles(r, grid, options);
+  expect(parallel.size() == tiles.size() && std::equal(tiles.begin(), tiles.end(), parallel.begin(),
+                                                       [](const auto &a, const auto &b) {
+                                                         return a.vertices == b.vertices && a.triangles == b.triangles;
+                                                       }), "parallel");
+
+  // The tiles memory is counted on top of the triangulation one
+  ec::TriangulationStats triangulationStats, tilesStats;
+  options.threads = 1;
+  options.stats = &triangulationStats;
+  ec::triangulate(r, options);
+  options.stats = &tilesStats;
+  ec::triangulateTiles(r, grid, options);
+  expect(tilesStats.allocations > triangulationStats.allocations &&
+         tilesStats.allocatedBytes > triangulationStats.allocatedBytes &&
+         tilesStats.peakBytes >= triangulationStats.peakBytes, "memory stats");
+
+  auto invalid = grid;
+  invalid.tileWidth = 0;
+  expect(ec::tryTriangulateTiles(r, invalid).status == ec::Status::INVALID_OPTIONS, "invalid grid");
+
+  std::cout << (failedCount == 0 ? "Ok" : "Failed") << '\n';
+  if (failedCount != 0)
+    std::cout << "Tiles: " << tiles.size() << ", area: " << tilesArea << " of " << expectedArea << '\n';
+  return failedCount;
+}
+
+// Attribute rows must give back the triangulate() points, the split points interpolated
+size_t testAttributes(const ec::Ring &r, std::optional<ec::FillRule> fillRule, size_t expectedSplits,
+                      const std::string &name) {
+  std::cout << "Test attributes. " << name << ": ";
+  size_t failedCount = 0;
+  auto expect = [&failedCount](bool ok, const std::string &name) {
+    if (!ok) {
+      std::cout << name << ": Failed ";
+      failedCount++;
+    }
+  };
+
+  // The attribute table of the user: the positions themselves
+  std::vector<ec::Point> table(r.begin(), r.end());
+  ec::Interpolate interpolate = [&table](uint32_t from, uint32_t to, double t) {
+    auto a = table[from], b = table[to];
+    table.push_back({a.x + t * (b.x - a.x), a.y + t * (b.y - a.y)});
+    return static_cast<uint32_t>(table.size() - 1);
+  };
+  ec::Options options;
+  options.fillRule = fillRule;
+  auto rows = ec::triangulateAttributes(r, interpolate, options);
+  auto expected = ec::triangulate(r, options);
+
+  expect(table.size() - r.size() == expectedSplits, "splits");
+  bool same = rows.size() == expected.size();
+  for (size_t t = 0; same && t < rows.size(); ++t) {
+    for (size_t i = 0; i < 3; ++i) {
+      auto p = table[rows[t][i]], q = expected[t][i];
+      same &= std::abs(p.x - q.x) <= 1e-9 * (1 + std::abs(q.x)) && std::abs(p.y - q.y) <= 1e-9 * (1 + std::abs(q.y));
+    }
+  }
+  expect(same, "points");
+
+  // The phases are timed and the returned rows are counted
+  ec::TriangulationStats stats;
+  options.stats = &stats;
+  table.assign(r.begin(), r.end());
+  auto counted = ec::triangulateAttributes(r, interpolate, options);
+  expect(stats.dedupTime > ec::TriangulationStats::Duration::zero() &&
+         stats.traversalTime > ec::TriangulationStats::Duration::zero() && stats.allocations > 0 &&
+         stats.allocatedBytes >= counted.capacity() * sizeof(ec::Mesh::Indices) &&
+         stats.peakBytes <= stats.allocatedBytes, "stats");
+
+  std::cout << (failedCount == 0 ? "Ok" : "Failed") << '\n';
+  if (failedCount != 0)
+    std::cout << "Triangles: " << rows.size() << " of " << expected.size() << ", rows: " << table.size() << '\n';
+  return failedCount;
+}
+
+// The batch must give each ring its triangulate() triangles over the shared vertices
+size_t testBatch(const std::pmr::vector<ec::Ring> &rings, size_t expectedVertices, const std::string &name) {
+  std::cout << "Test batch. " << name << ": ";
+  size_t failedCount = 0;
+  auto expect = [&failedCount](bool ok, const std::string &name) {
+    if (!ok) {
+      std::cout << name << ": Failed ";
+      failedCount++;
+    }
+  };
+
+  ec::Options options;
+  options.threads = 1;
+  auto batch = ec::tryTriangulateBatch(rings, options);
+  const auto &mesh = batch.value;
+  expect(mesh.vertices.size() == expectedVertices, "vertices");
+  expect(mesh.ringOffsets.size() == rings.size() + 1 && mesh.ringStatuses.size() == rings.size(), "rings");
+
+  auto worst = ec::Status::OK;
+  for (size_t r = 0; r < rings.size() && failedCount == 0; ++r) {
+    auto expected = ec::tryTriangulate(rings[r]);
+    if (expected.status != ec::Status::DEGENERATE)
+      worst = std::max(worst, expected.status);
+    expect(mesh.ringStatuses[r] == expected.status, "ring status");
+    bool same = mesh.ringOffsets[r + 1] - mesh.ringOffsets[r] == expected.value.size();
+    for (size_t t = 0; same && t < expected.value.size(); ++t) {
+      const auto &indices = mesh.triangles[mesh.ringOffsets[r] + t];
+      for (size_t i = 0; i < 3; ++i)
+        same &= indices[i] < mesh.vertices.size() && mesh.vertices[indices[i]] == expected.value[t][i];
+    }
+    expect(same, "ring " + std::to_string(r));
+  }
+  if (worst == ec::Status::OK && mesh.triangles.empty())
+    worst = ec::Status::DEGENERATE;
+  expect(batch.status == worst, "status");
+
+  // The workers don't change the result
+  options.threads = 4;
+  auto parallel = ec::tryTriangulateBatch(rings, options);
+  expect(parallel.value.vertices == mesh.vertices && parallel.value.triangles == mesh.triangles, "threads");
+
+  // The returned mesh is counted, not only the rings memory
+  ec::TriangulationStats stats;
+  options.stats = &stats;
+  ec::tryTriangulateBatch(rings, options);
+  auto meshBytes = mesh.vertices.size() * sizeof(ec::Point) + mesh.triangles.size() * sizeof(ec::Mesh::Indices);
+  expect(stats.allocations > 0 && stats.peakBytes >= meshBytes && stats.allocatedBytes >= stats.peakBytes,
+         "memory stats");
+  options.stats = nullptr;
+
+  options.snapTolerance = -1;
+  expect(ec::tryTriangulateBatch(rings, options).status == ec::Status::INVALID_OPTIONS, "invalid options");
+
+  std::cout << (failedCount == 0 ? "Ok" : "Failed") << '\n';
+  if (failedCount != 0)
+    std::cout << "Vertices: " << mesh.vertices.size() << ", triangles: " << mesh.triangles.size() << '\n';
+  return failedCount;
+}
+
+// Runs the posted tasks when asked, like an event loop
+class QueueExecutor : public ec::Executor {
+ public:
+  void post(std::function<void()> task) override { tasks.push_back(std::move(task)); }
+  void run() {
+    for (; !tasks.empty(); tasks.pop_front())
+      tasks.front()();
+  }
+  std::deque<std::function<void()>> tasks;
+};
+
+class ThreadExecutor : public ec::Executor {
+ public:
+  ~ThreadExecutor() override {
+    for (auto &t : threads)
+      t.join();
+  }
+  void post(std::function<void()> task) override { threads.emplace_back(std::move(task)); }
+  std::vector<std::thread> threads;
+};
+
+size_t testAsync(const ec::Ring &r, const std::string &name) {
+  std::cout << "Test async. " << name << ": ";
+  size_t failedCount = 0;
+  auto expect = [&failedCount](bool ok, const std::string &name) {
+    if (!ok) {
+      std::cout << name << ": Failed ";
+      failedCount++;
+    }
+  };
+
+  ec::TriangulationStats stats;
+  ec::Options options;
+  options.stats = &stats;
+  auto expected = ec::triangulate(r, options);
+
+  QueueExecutor queue;
+  auto call = ec::triangulateAsync(r, queue);
+  expect(!call.ready() && queue.tasks.size() == 1, "posted");
+  std::optional<ec::AsyncResult> completion;
+  call.then([&completion](ec::AsyncResult result) { completion = std::move(result); });
+  queue.run();
+  expect(call.ready() && completion && completion->status == ec::tryTriangulate(r).status &&
+             completion->triangles == expected,
+         "then");
+  expect(completion && completion->stats.splitPoints == stats.splitPoints, "stats");
+
+  call = ec::triangulateAsync(r, queue);
+  call.cancel();
+  queue.run();
+  auto cancelled = call.get();
+  expect(cancelled.status == ec::Status::CANCELLED && cancelled.triangles.empty(), "cancel");
+
+  call = ec::triangulateAsync(r, queue);
+  queue.tasks.clear();
+  expect(call.ready() && call.get().status == ec::Status::CANCELLED, "dropped");
+
+  {
+    ThreadExecutor threads;
+    ec::Options nonZero;
+    nonZero.fillRule = ec::FillRule::NON_ZERO;
+    auto first = ec::triangulateAsync(r, threads);
+    auto second = ec::triangulateAsync(r, threads, nonZero);
+    expect(first.get().triangles == expected, "thread");
+    expect(second.get().triangles == ec::triangulate(r, nonZero), "thread fill rule");
+  }
+
+  std::cout << (failedCount == 0 ? "Ok" : "Failed") << '\n';
+  return failedCount;
+}
+
+// The index must agree with a linear scan of closed triangles
+size_t testPointLocator(const ec::Ring &r, const std::string &name) {
+  std::cout << "Test point locator. " << name << ": ";
+  auto triangles = ec::triangulate(r);
+  ec::PointLocator locator(triangles);
+  auto scan = [&](ec::Point p) {
+    for (size_t i = 0; i < triangles.size(); ++i) {
+      const auto &t = triangles[i];
+      if (ecd::vertexOrder(t) != ecd::VertexOrder::NO_AREA && (ecd::pointInTriangle(t, p) || p == t[0] || p == t[1] || p == t[2]))
+        return i;
+    }
+    return ec::PointLocator::NO_TRIANGLE;
+  };
+
+  // Random points over the bbox, the vertices and the edge middles
+  std::vector<ec::Point> points;
+  auto [minX, maxX] = std::minmax_element(r.begin(), r.end(), [](auto a, auto b) { return a.x < b.x; });
+  auto [minY, maxY] = std::minmax_element(r.begin(), r.end(), [](auto a, auto b) { return a.y < b.y; });
+  std::mt19937 random(7);
+  std::uniform_real_distribution<double> x(minX->x - 1, maxX->x + 1), y(minY->y - 1, maxY->y + 1);
+  for (size_t i = 0; i < 2000; ++i)
+    points.push_back({x(random), y(random)});
+  for (const auto &t : triangles) {
+    points.insert(points.end(), t.begin(), t.end());
+    points.push_back({(t[0].x + t[1].x) / 2, (t[0].y + t[1].y) / 2});
+  }
+
+  std::vector<size_t> batch(points.size());
+  locator.locate(points.data(), points.size(), batch.data());
+  size_t failed = 0;
+  for (size_t i = 0; i < points.size(); ++i) {
+    auto expected = scan(points[i]);
+    if (locator.locate(points[i]) != expected || batch[i] != expected) {
+      if (failed++ == 0)
+        std::cout << "Point " << points[i] << ": " << locator.locate(points[i]) << " != " << expected << '\n';
+    }
+  }
+  std::cout << (failed == 0 ? "OK" : "Failed") << '\n';
+
+  return failed;
+}
+
+// The neighbours must agree with an edge map built over the triangles
+size_t checkNeighbours(const ec::Mesh &mesh) {
+  std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>> edges;
+  for (uint32_t t = 0; t < mesh.triangles.size(); ++t) {
+    for (size_t i = 0; i < 3; ++i)
+      edges[{mesh.triangles[t][i], mesh.triangles[t][(i + 1) % 3]}].push_back(t);
+  }
+
+  size_t failed = 0;
+  for (uint32_t t = 0; t < mesh.triangles.size(); ++t) {
+    for (size_t i = 0; i < 3; ++i) {
+      auto from = mesh.triangles[t][i], to = mesh.triangles[t][(i + 1) % 3];
+      const auto &opposite = edges[{to, from}];
+      auto n = mesh.neighbours[t][i];
+      bool ok;
+      if (n == ec::Mesh::NO_NEIGHBOUR) {
+        ok = opposite.empty() || edges[{from, to}].size() > 1;
+      } else {
+        // Symmetric and across the same edge
+        ok = std::find(opposite.begin(), opposite.end(), n) != opposite.end();
+        const auto &back = mesh.neighbours[n];
+        ok &= std::find(back.begin(), back.end(), t) != back.end();
+      }
+      if (!ok && failed++ == 0)
+        std::cout << "Triangle " << t << " edge " << i << ": neighbour " << n << '\n';
+    }
+  }
+
+  return failed;
+}
+
+// The mesh triangles must be the triangulate() ones
+size_t testMesh(const ec::Ring &r, std::optional<ec::FillRule> rule, const std::string &name) {
+  std::cout << "Test mesh. " << name << ": ";
+  ec::Options options;
+  options.fillRule = rule;
+  options.threads = 1;
+  auto mesh = ec::triangulateMesh(r, options);
+  auto triangles = ec::triangulate(r, options);
+
+  size_t failed = mesh.triangles.size() != triangles.size() || mesh.neighbours.size() != triangles.size();
+  for (size_t t = 0; failed == 0 && t < triangles.size(); ++t) {
+    for (size_t i = 0; i < 3; ++i)
+      failed += !(mesh.vertices[mesh.triangles[t][i]] == triangles[t][i]);
+  }
+  if (failed != 0) {
+    std::cout << "Failed: triangles differ\n";
+    return failed;
+  }
+
+  failed += checkNeighbours(mesh);
+  std::cout << (failed == 0 ? "OK" : "Failed") << '\n';
+
+  return failed;
+}
+
+// Sorted triangles, each rotated to start at its smallest index(the orientation is kept)
+std::vector<ec::Mesh::Indices> canonical(const std::pmr::vector<ec::Mesh::Indices> &triangles) {
+  std::vector<ec::Mesh::Indices> result;
+  for (auto t : triangles) {
+    std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+    result.push_back(t);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// A wavy band of the vertices count
+ec::Ring wave(size_t vertices) {
+  ec::Ring result;
+  auto half = vertices / 2;
+  for (size_t i = 0; i < half; ++i)
+    result.push_back({double(i), std::sin(0.1 * double(i))});
+  for (size_t i = half; i-- > 0;)
+    result.push_back({double(i), 3 + std::sin(0.1 * double(i))});
+  return result;
+}
+
+// The reorders must keep the triangles and the adjacency, the strips and
+// fans must give the same triangles back
+size_t testMeshOrder(const ec::Ring &r, const std::string &name) {
+  std::cout << "Test mesh order. " << name << ": ";
+  auto mesh = ec::triangulateMesh(r);
+  auto expected = canonical(mesh.triangles);
+  auto clipAcmr = ec::acmr(mesh.triangles);
+  size_t failed = 0;
+
+  auto hilbert = mesh;
+  ec::reorderAlongHilbertCurve(hilbert);
+  failed += canonical(hilbert.triangles) != expected;
+  failed += checkNeighbours(hilbert);
+
+  auto cache = mesh;
+  ec::reorderForVertexCache(cache);
+  failed += canonical(cache.triangles) != expected;
+  failed += checkNeighbours(cache);
+  auto cacheAcmr = ec::acmr(cache.triangles);
+  failed += cacheAcmr > clipAcmr;
+
+  auto strips = ec::triangleStrips(cache);
+  auto fans = ec::triangleFans(mesh);
+  failed += canonical(ec::unpack(strips, ec::Primitive::TRIANGLE_STRIP)) != expected;
+  failed += canonical(ec::unpack(fans, ec::Primitive::TRIANGLE_FAN)) != expected;
+  failed += strips.size() >= 3 * mesh.triangles.size() || fans.size() >= 3 * mesh.triangles.size();
+
+  std::cout << (failed == 0 ? "OK" : "Failed") << '\n';
+  if (failed != 0)
+    std::cout << "ACMR: clip " << clipAcmr << ", vertex cache " << cacheAcmr << ", indices: triangles "
+              << 3 * mesh.triangles.size() << ", strips " << strips.size() << ", fans " << fans.size() << '\n';
+
+  return failed;
+}
+
+size_t testPredicates() {
+  std::cout << "Test predicates: ";
+  size_t failed = 0;
+  failed += ecd::orient({0, 0}, {1, 0}, {0, 1}) <= 0;
+  failed += ecd::orient({0, 0}, {0, 1}, {1, 0}) >= 0;
+  failed += ecd::orient({0.1, 0.1}, {0.3, 0.3}, {0.7, 0.7}) != 0;
+  failed += ecd::inCircle({0, 0}, {1, 0}, {0, 1}, {1, 1}) != 0;
+  failed += ecd::inCircle({0, 0}, {1, 0}, {0, 1}, {1, 1 - 0x1p-52}) <= 0;
+  failed += ecd::inCircle({0, 0}, {1, 0}, {0, 1}, {1, 1 + 0x1p-52}) >= 0;
+  failed += ecd::inCircle({0, 0}, {0, 1}, {1, 0}, {0.5, 0.5}) >= 0; // clockwise
+  // Far from the origin the filter fails, the exact result must be 0
+  const double big = 1e15;
+  failed += ecd::inCircle({big, big}, {big + 1, big}, {big, big + 1}, {big + 1, big + 1}) != 0;
+  std::cout << (failed == 0 ? "OK" : "Failed") << '\n';
+
+  return failed;
+}
+
+// The flips must keep the area and the ring edges, the result must be locally Delaunay
+size_t testDelaunay(const ec::Ring &r, bool expectFlips, const std::string &name) {
+  std::cout << "Test delaunay. " << name << ": ";
+  auto mesh = ec::triangulateMesh(r);
+  auto ringEdges = [](const ec::Mesh &m) {
+    std::vector<std::pair<uint32_t, uint32_t>> result;
+    for (size_t t = 0; t < m.triangles.size(); ++t) {
+      for (size_t i = 0; i < 3; ++i) {
+        if (m.constrained[t][i])
+          result.emplace_back(m.triangles[t][i], m.triangles[t][(i + 1) % 3]);
+      }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  auto triangles = [](const ec::Mesh &m) {
+    ec::Triangles result;
+    for (const auto &t : m.triangles)
+      result.push_back({m.vertices[t[0]], m.vertices[t[1]], m.vertices[t[2]]});
+    return result;
+  };
+  auto edges = ringEdges(mesh);
+  auto expectedArea = area(triangles(mesh));
+
+  auto flips = ec::makeDelaunay(mesh);
+  size_t failed = checkNeighbours(mesh);
+  failed += ringEdges(mesh) != edges;
+  failed += !expectEqual(area(triangles(mesh)), expectedArea);
+  failed += expectFlips != (flips > 0);
+  for (uint32_t t = 0; t < mesh.triangles.size(); ++t) {
+    for (size_t i = 0; i < 3; ++i) {
+      auto n = mesh.neighbours[t][i];
+      if (mesh.constrained[t][i] || n == ec::Mesh::NO_NEIGHBOUR)
+        continue;
+      const auto &a = mesh.triangles[t];
+      uint32_t opposite = 0;
+      for (auto v : mesh.triangles[n]) {
+        if (v != a[i] && v != a[(i + 1) % 3])
+          opposite = v;
+      }
+      auto p = [&](uint32_t v) { return mesh.vertices[v]; };
+      auto orientation = ecd::orient(p(a[0]), p(a[1]), p(a[2])) > 0 ? 1 : -1;
+      failed += orientation * ecd::inCircle(p(a[0]), p(a[1]), p(a[2]), p(opposite)) > 0;
+    }
+  }
+  std::cout << (failed == 0 ? "OK" : "Failed") << '\n';
+  if (failed != 0)
+    std::cout << "Flips: " << flips << '\n';
+
+  return failed;
+}
+
+// The simplified ring must stay simple and keep about the same area
+size_t testSimplify() {
+  std::cout << "Test simplify: ";
+  size_t failed = 0;
+
+  // Collinear points on the square edges
+  ec::Ring square;
+  for (int i = 0; i < 10; ++i)
+    square.push_back({double(i), 0});
+  for (int i = 0; i < 10; ++i)
+    square.push_back({10, double(i)});
+  for (int i = 10; i > 0; --i)
+    square.push_back({double(i), 10});
+  for (int i = 10; i > 0; --i)
+    square.push_back({0, double(i)});
+  failed += !expectEqual(ec::simplify(square, 0), {{0, 0}, {10, 0}, {10, 10}, {0, 10}});
+
+  // A narrow U: the prongs are closer than the tolerance, they mustn't be joined
+  ec::Ring u = {{0, 0}, {3, 0}, {3, 10}, {2.05, 10}, {2.05, 1}, {1.95, 1}, {1.95, 10}, {1, 10}, {1, 0.5}, {0, 0.5}};
+  {
+    ec::TriangulationStats stats;
+    ec::Options options;
+    options.stats = &stats;
+    options.simplifyTolerance = 1;
+    ec::triangulate(u, options);
+    failed += stats.splitPoints != 0 || stats.simplifiedPoints == 0;
+  }
+
+  // Noisy circles: no self intersections, the area within the tolerance band
+  std::mt19937 random(11);
+  std::uniform_real_distribution<double> noise(-0.02, 0.02);
+  for (int i = 0; i < 20; ++i) {
+    ec::Ring circle;
+    for (int k = 0; k < 500; ++k) {
+      auto angle = 2 * M_PI * k / 500;
+      auto radius = 1 + noise(random) + (k % 50 < 25 ? 0.3 : 0);
+      circle.push_back({radius * std::cos(angle), radius * std::sin(angle)});
+    }
+    const double tolerance = 0.05;
+    ec::TriangulationStats stats;
+    ec::Options options;
+    options.stats = &stats;
+    options.simplifyTolerance = tolerance;
+    auto triangles = ec::triangulate(circle, options);
+    failed += stats.splitPoints != 0 || stats.simplifiedPoints < 250;
+    failed += std::abs(area(triangles) - area(circle)) > tolerance * 2 * M_PI * 1.3 * 2;
+  }
+  std::cout << (failed == 0 ? "OK" : "Failed") << '\n';
+
+  return failed;
+}
+
+// The real output must pass, the broken ones must be caught
+size_t testVerify(const ec::Ring &r, std::optional<ec::FillRule> rule, const std::string &name) {
+  std::cout << "Test verify. " << name << ": ";
+  ec::Options options;
+  options.fillRule = rule;
+  auto triangles = ec::triangulate(r, options);
+  auto report = ec::verifyTriangulation(r, triangles, options);
+  size_t failed = !report.valid() || !report.boundaryMatches;
+
+  auto missing = triangles;
+  missing.pop_back();
+  failed += ec::verifyTriangulation(r, missing, options).areaMatches();
+
+  auto duplicate = triangles;
+  duplicate.push_back(duplicate.front());
+  report = ec::verifyTriangulation(r, duplicate, options);
+  failed += report.overlappingPairs != 1 || report.firstOverlap != std::pair<size_t, size_t>(0, triangles.size());
+
+  // Grown over the neighbours
+  auto grown = triangles;
+  auto &t = grown.front();
+  ec::Point center{(t[0].x + t[1].x + t[2].x) / 3, (t[0].y + t[1].y + t[2].y) / 3};
+  for (auto &p : t)
+    p = {center.x + 2 * (p.x - center.x), center.y + 2 * (p.y - center.y)};
+  failed += ec::verifyTriangulation(r, grown, options).overlappingPairs == 0;
+
+  if (!rule) {
+    auto flipped = triangles;
+    std::swap(flipped.front()[0], flipped.front()[1]);
+    failed += ec::verifyTriangulation(r, flipped, options).wrongOrientation != 1;
+
+    // All of them reversed: no minority orientation, but none has the ring one
+    auto reversed = triangles;
+    for (auto &triangle : reversed)
+      std::swap(triangle[1], triangle[2]);
+    report = ec::verifyTriangulation(r, reversed, options);
+    failed += report.valid() || report.wrongOrientation != triangles.size();
+  }
+  std::cout << (failed == 0 ? "OK" : "Failed") << '\n';
+
+  return failed;
+}
+
+// A random walk: short edges crossing their neighbours
+ec::Ring scribble(size_t vertices) {
+  ec::Ring result;
+  std::mt19937 random(7);
+  ec::Point p{0, 0};
+  for (size_t i = 0; i < vertices; ++i) {
+    p.x += double(random() % 21) - 10;
+    p.y += double(random() % 21) - 10;
+    result.push_back(p);
+  }
+  return result;
+}
+
+// {vertices/step} star polygon: every edge crosses most of the others
+ec::Ring starPolygon(size_t vertices, size_t step) {
+  ec::Ring result;
+  for (size_t i = 0; i < vertices; ++i) {
+    auto angle = 2 * M_PI * double(i * step % vertices) / double(vertices);
+    result.push_back({std::round(1000 * std::cos(angle)), std::round(1000 * std::sin(angle))});
+  }
+  return result;
+}
+
+// The partitioned search must find the same crossings in the same order as the plain loop
+size_t testIntersectionSearch(const ec::Ring &r, const std::string &name) {
+  std::cout << "Test intersection search. " << name << ": ";
+  size_t failedCount = 0;
+  auto expect = [&failedCount](bool ok, const std::string &name) {
+    if (!ok) {
+      std::cout << name << ": Failed ";
+      failedCount++;
+    }
+  };
+
+  std::pmr::vector<ecd::Segment> segments;
+  for (auto i = r.begin(), j = std::next(r.begin()); j != r.end(); i = j++)
+    segments.push_back({*i, *j});
+  auto serial = ecd::findCrossings(segments, 1, nullptr, std::pmr::get_default_resource()).value;
+  auto parallel = ecd::findCrossings(segments, 4, nullptr, std::pmr::get_default_resource()).value;
+  expect(!serial.empty(), "crossings");
+  expect(std::equal(serial.begin(), serial.end(), parallel.begin(), parallel.end(), [](const auto &a, const auto &b) {
+    return a.first == b.first && a.second == b.second && a.point == b.point;
+  }), "same crossings");
+
+  ec::Options options;
+  options.threads = 1;
+  auto serialRing = ecd::normalizeRing(r, options);
+  auto serialFaces = ecd::normalizeFaces(r, ec::FillRule::EVEN_ODD, options);
+  options.threads = 4;
+  expect(ecd::normalizeRing(r, options) == serialRing, "same ring");
+  expect(ecd::normalizeFaces(r, ec::FillRule::EVEN_ODD, options) == serialFaces, "same faces");
+
+  std::atomic<bool> cancel = true;
+  auto cancelled = ecd::findCrossings(segments, 4, &cancel, std::pmr::get_default_resource());
+  expect(cancelled.status == ec::Status::CANCELLED && cancelled.value.empty(), "cancel");
+
+  std::cout << (failedCount == 0 ? "Ok" : "Failed") << '\n';
+  return failedCount;
+}
+
+// A warmed up call with a pool memory resource shouldn't touch the heap
+bool testSteadyStateAllocations(const ec::Ring &r, size_t expectedTriangles, const std::string &name) {
+  std::cout << "Test steady state allocations. " << name << ": ";
+  std::pmr::unsynchronized_pool_resource pool(std::pmr::pool_options{0, 1 << 20});
+  ec::TriangulationStats stats;
+  ec::Options options;
+  options.stats = &stats;
+  options.memory = &pool;
+  auto run = [&]() {
+    ec::Ring ring(r.begin(), r.end(), &pool);
+    return ec::triangulate(std::move(ring), options).size();
+  };
+
+  run();
+  heapAllocations = 0;
+  countHeapAllocations = true;
+  auto size = run();
+  countHeapAllocations = false;
+
+  bool ok = heapAllocations == 0 && size == expectedTriangles;
+  std::cout << (ok ? "OK" : "Failed") << '\n';
+  if (!ok)
+    std::cout << "Heap allocations: " << heapAllocations << ", triangles: " << size << '\n';
+
+  return !ok;
+}
+
+int main(int argc, char *argv[]) {
   size_t failed = 0;
   ec::enableTrace(false);
+  bool zeroAllocationMode = argc > 1 && std::strcmp(argv[1], "--zero-allocation") == 0;
 
   failed += testRingRotation({{{0, 0}, {0, 1}, {1, 0}}}, ecd::VertexOrder::CLOCKWISE);
   failed += testRingRotation({{{0, 0}, {1, 0}, {0, 1}}}, ecd::VertexOrder::C_CLOCKWISE);
@@ -264,6 +1384,15 @@ int main() {
 
   failed += testPointInTriangle();
 
+  failed += testPointWelder();
+  failed += testClockwiseOrder();
+  failed += testPlanarGraphFaces({{0, 0}, {1, 0}, {0, 1}, {1, 1}, {0.5, 0.5}},
+                                 {{0, 1}, {1, 4}, {4, 2}, {2, 3}, {3, 4}, {4, 0}}, 2, "8-ring");
+  failed += testPlanarGraphFaces({{0, 0}, {1, 0}, {1, 1}, {0, 1}},
+                                 {{0, 1}, {1, 2}, {2, 3}, {3, 0}, {0, 2}}, 2, "Square with a diagonal");
+  failed += testPlanarGraphFaces({{0, 0}, {1, 0}, {2, 0}},
+                                 {{0, 1}, {1, 2}}, 0, "Polyline");
+
   failed += testAngle();
 
   const ec::Ring simplestRing = {{{0, 0}, {1, 0}, {0, 1}}};
@@ -316,6 +1445,10 @@ int main() {
                            {654.538, 348.806}, {536.24, 375.724}, {471, 581}, {460.761, 392.899}, {330.772, 422.477},
                            {290, 544}, {263.666, 437.747}, {56, 485}});
 
+  const ec::Ring squareNearDuplicate = {{{-1, -1}, {1, -1}, {1 + 1e-13, -1}, {1, 1}, {-1, 1}, {-1, -1 + 1e-13}}};
+  failed += testNormalizeSnapping(squareNearDuplicate, 1e-9, {{1, -1}, {1, 1}, {-1, 1}, {-1, -1}});
+  failed += testNormalizeSnapping(ring8, 1e-9, {{1, 0}, {0.5, 0.5}, {1, 1}, {0, 1}, {0.5, 0.5}, {0, 0}});
+
   failed += testNormalize(zeroAreaLoop, {{1, 0}, {0, 0}});
   failed += testNormalize(zeroAreaLoop2, {{1, 0}, {2, 0}, {1, 0}, {0, 0}});
   failed += testNormalize(zeroAreaLoop3, {{1, 0}, {2, 0}, {3, 0}, {2, 0}, {1, 0}, {0, 0}});
@@ -407,11 +1540,92 @@ int main() {
                                  {{{351.022, 338.149}, {154, 723}, {116, 689}}}, {{{351.022, 338.149}, {116, 689}, {118, 553}}}}},
                             "Zero area triangle");
 
+  const ec::Ring pentagram = {{{0, 3}, {2, -3}, {-3, 1}, {3, 1}, {-2, -3}}};
+  failed += testFaces(ring8, ec::FillRule::EVEN_ODD, {3, 3}, "8-ring");
+  failed += testFaces(square, ec::FillRule::NON_ZERO, {4}, "Square");
+  failed += testFaces(zeroAreaLoop3, ec::FillRule::NON_ZERO, {}, "Empty loop");
+  failed += testFaces(pentagram, ec::FillRule::EVEN_ODD, {3, 3, 3, 3, 3}, "Pentagram even-odd");
+  failed += testFaces(pentagram, ec::FillRule::NON_ZERO, {3, 3, 3, 3, 3, 5}, "Pentagram non-zero");
+  failed += testFaces(ringCross, ec::FillRule::NON_ZERO, {3, 3, 3}, "Ring cross");
+  failed += testTriangulateFaces(ring8, ec::FillRule::EVEN_ODD, 0.5, "8-ring");
+  failed += testTriangulateFaces(pentagram, ec::FillRule::EVEN_ODD, 8.477193, "Pentagram even-odd");
+  failed += testTriangulateFaces(pentagram, ec::FillRule::NON_ZERO, 12.238596, "Pentagram non-zero");
+
+  failed += testIncremental();
+  failed += testPointLocator(ringInf, "Inf");
+  failed += testPointLocator(ring8Complex2, "8-ring complex2");
+  failed += testPointLocator(square, "Square");
+  failed += testPointLocator(starPolygon(500, 1), "Circle");
+  failed += testPointLocator(wave(300), "Wave");
+  failed += testCancel(ringInf, "Inf");
+  failed += testStatus(square, ec::Status::OK, "Square");
+  failed += testStatus(ringInf, ec::Status::NO_PROGRESS, "Inf");
+  failed += testAsync(ringInf, "Inf");
+  failed += testTiles(square, std::nullopt, {{-1, -1}, 0.5, 0.5, 4, 4}, 16, 1, "Square");
+  failed += testTiles(square, std::nullopt, {{0, 0}, 0.5, 0.5, 4, 4}, 4, 0.25, "Square quarter");
+  failed += testTiles(ringInf, ec::FillRule::NON_ZERO, {{50, 50}, 100, 100, 10, 10}, 38, 1, "Inf");
+  failed += testTiles(wave(300), std::nullopt, {{-10, -10}, 7, 3, 100, 100}, 44, 1, "Wave");
+  failed += testAttributes(square, std::nullopt, 0, "Square");
+  failed += testAttributes(ring8, std::nullopt, 1, "8-ring");
+  failed += testAttributes(ringInf, std::nullopt, 7, "Inf");
+  failed += testAttributes(pentagram, ec::FillRule::NON_ZERO, 5, "Pentagram non-zero");
+  failed += testAttributes(scribble(300), ec::FillRule::EVEN_ODD, 189, "Scribble even-odd");
+  {
+    // Unit squares of a 10 x 10 coverage share their sides
+    std::pmr::vector<ec::Ring> cells;
+    for (size_t i = 0; i < 100; ++i) {
+      double x = double(i % 10), y = double(i / 10);
+      cells.push_back({{x, y}, {x, y + 1}, {x + 1, y + 1}, {x + 1, y}});
+    }
+    failed += testBatch(cells, 121, "Coverage");
+    cells.push_back(ring8);
+    cells.push_back({{0, 0}, {1, 1}, {2, 2}});
+    failed += testBatch(cells, 122, "Coverage, 8-ring and no area"); // their points are on the grid but the crossing
+    failed += testBatch({}, 0, "Empty");
+  }
+  failed += testTriangulator(ringInf, std::nullopt, "Inf");
+  failed += testTriangulator(ringInf, ec::FillRule::EVEN_ODD, "Inf even-odd");
+  failed += testTriangulator(wave(300), std::nullopt, "Wave");
+  failed += testTriangulator(scribble(3000), ec::FillRule::NON_ZERO, "Scribble non-zero");
+  failed += testMesh(square, std::nullopt, "Square");
+  failed += testMesh(ringInf, std::nullopt, "Inf");
+  failed += testMesh(ring8Complex2, std::nullopt, "8-ring complex2");
+  failed += testMesh(zeroAreaTriangleBag, std::nullopt, "Zero area triangle");
+  failed += testMesh(pentagram, ec::FillRule::EVEN_ODD, "Pentagram even-odd");
+  failed += testMesh(pentagram, ec::FillRule::NON_ZERO, "Pentagram non-zero");
+  failed += testMeshOrder(ringInf, "Inf");
+  failed += testMeshOrder(ring8Complex2, "8-ring complex2");
+  failed += testMeshOrder(wave(2000), "Wave");
+  failed += testSimplify();
+  failed += testVerify(ringInf, ec::FillRule::NON_ZERO, "Inf");
+  failed += testVerify(square, std::nullopt, "Square");
+  failed += testVerify(ring8Complex2, std::nullopt, "8-ring complex2");
+  failed += testVerify(wave(300), std::nullopt, "Wave");
+  failed += testVerify(pentagram, ec::FillRule::NON_ZERO, "Pentagram non-zero");
+  failed += testVerify(pentagram, ec::FillRule::EVEN_ODD, "Pentagram even-odd");
+  failed += testIntersectionSearch(scribble(3000), "Scribble");
+  failed += testIntersectionSearch(starPolygon(151, 75), "Star polygon");
+  failed += testPredicates();
+  failed += testDelaunay(square, false, "Square");
+  failed += testDelaunay(ringInf, true, "Inf");
+  failed += testDelaunay(wave(400), true, "Wave");
+  failed += testDelaunay(zeroAreaTriangleBag, true, "Zero area triangle");
+
+  failed += testStats(square, 0, "Square");
+  failed += testStats(ringInf, 7, "Inf");
+  failed += testStdContainers(ringInf, "Inf");
+
+  if (zeroAllocationMode) {
+    failed += testSteadyStateAllocations(square, 2, "Square");
+    failed += testSteadyStateAllocations(ring8Complex, 7, "8-ring complex");
+    failed += testSteadyStateAllocations(ringInf, 15, "Inf");
+  }
+
   if (failed == 0) {
     std::cout << "All test passed\n";
   } else {
     std::cout << failed << " tests failed\n";
   }
 
-  return 0;
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }